@@ -0,0 +1,580 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Apply a chain of filters to every image in a directory. Decoding, filtering and encoding run in separate
+// thread pools connected by bounded queues so every core stays busy and memory use stays fixed.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <errno.h>
+#include <fstream>
+#include <set>
+#include <opencv2/opencv.hpp>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "convolve.h"
+#include "filter.h"
+#include "frame_pool.h"
+#include "histogram_utils.h"
+#include "median.h"
+#include "planar.h"
+
+/**
+ * @brief One filter of the chain, e.g. "quantize:8" is the filter "quantize" with parameter 8.
+ */
+struct FilterStage
+{
+    std::string name;
+    double param;
+    bool hasParam;
+    cv::Mat kernel; // Loaded from the file named by the parameter of "convolve"
+};
+
+/**
+ * @brief An image travelling through the pipeline.
+ */
+struct BatchItem
+{
+    std::string name;
+    std::string output;
+    cv::Mat image;
+};
+
+/**
+ * @brief Buffers owned by a single worker thread and reused from one image to the next.
+ */
+struct WorkerBuffers
+{
+    cv::Mat ping;
+    cv::Mat pong;
+    PlanarImage planarSrc;
+    PlanarImage planarBlur;
+    PlanarImage planarDst;
+    FramePool pool;
+    cv::Size lastSize;
+};
+
+/**
+ * @brief Counters shared by all the stages, read by the progress report.
+ */
+struct BatchProgress
+{
+    std::atomic<int> listed;
+    std::atomic<int> decoded;
+    std::atomic<int> filtered;
+    std::atomic<int> written;
+    std::atomic<int> failed;
+    std::atomic<bool> finished;
+};
+
+static const char *FILTER_NAMES = "grey, sepia, blur, magnitude, edges, brightness[:factor], negative, "
+                                  "quantize[:levels], cartoon[:levels], median[:radius], clahe[:clipLimit], "
+                                  "convolve:kernelFile";
+
+/**
+ * @brief Read a convolution kernel from a text file with one kernel row per line.
+ *
+ * @param filename The kernel file, e.g. three lines of "0 -1 0", "-1 5 -1" and "0 -1 0".
+ * @param kernel The CV_32FC1 kernel.
+ * @return 0 if successful, -1 if error.
+ */
+static int readKernel(const std::string &filename, cv::Mat &kernel)
+{
+    std::ifstream file(filename.c_str());
+    if (!file)
+    {
+        printf("Unable to open kernel file %s\n", filename.c_str());
+        return -1;
+    }
+
+    std::vector<float> values;
+    int rows = 0, cols = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::vector<float> row;
+        float value;
+        while (stream >> value)
+        {
+            row.push_back(value);
+        }
+        if (row.empty())
+        {
+            continue;
+        }
+        if (rows > 0 && (int)row.size() != cols)
+        {
+            printf("Kernel rows of %s have different lengths\n", filename.c_str());
+            return -1;
+        }
+        cols = row.size();
+        values.insert(values.end(), row.begin(), row.end());
+        rows++;
+    }
+
+    if (rows == 0)
+    {
+        printf("Kernel file %s is empty\n", filename.c_str());
+        return -1;
+    }
+
+    kernel = cv::Mat(rows, cols, CV_32F, values.data()).clone();
+    return 0;
+}
+
+/**
+ * @brief Parse a comma separated filter chain such as "clahe,blur,quantize:8".
+ *
+ * @param chain The filter chain.
+ * @param stages The parsed stages.
+ * @return 0 if successful, -1 if a filter is unknown.
+ */
+static int parseChain(const std::string &chain, std::vector<FilterStage> &stages)
+{
+    size_t start = 0;
+    while (start <= chain.size())
+    {
+        size_t end = chain.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = chain.size();
+        }
+
+        std::string token = chain.substr(start, end - start);
+        start = end + 1;
+        if (token.empty())
+        {
+            continue;
+        }
+
+        FilterStage stage;
+        size_t colon = token.find(':');
+        stage.name = token.substr(0, colon);
+        stage.hasParam = colon != std::string::npos;
+        stage.param = stage.hasParam ? atof(token.c_str() + colon + 1) : 0;
+
+        if (stage.name == "convolve")
+        {
+            if (!stage.hasParam || readKernel(token.substr(colon + 1), stage.kernel) != 0)
+            {
+                printf("convolve needs a kernel file, e.g. convolve:sharpen.txt\n");
+                return -1;
+            }
+            stages.push_back(stage);
+            continue;
+        }
+
+        if (stage.name != "grey" && stage.name != "sepia" && stage.name != "blur" && stage.name != "magnitude" &&
+            stage.name != "edges" && stage.name != "brightness" && stage.name != "negative" &&
+            stage.name != "quantize" && stage.name != "cartoon" && stage.name != "median" && stage.name != "clahe")
+        {
+            printf("Unknown filter: %s\n", stage.name.c_str());
+            return -1;
+        }
+        stages.push_back(stage);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Blur an image and take its gradient magnitude in planar form.
+ *
+ * The image is converted to planes once on entry and back once on exit, both kernels run on the planes in between.
+ * The magnitude saturates at 255 instead of wrapping around like the "magnitude" stage.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image.
+ * @param buffers The worker's buffers, holding the planar images.
+ * @return 0 if successful, -1 if error.
+ */
+static int planarEdges(const cv::Mat &src, cv::Mat &dst, WorkerBuffers &buffers)
+{
+    if (bgrToPlanar(src, buffers.planarSrc) != 0 || blur5x5Planar(buffers.planarSrc, buffers.planarBlur) != 0 ||
+        magnitudePlanar(buffers.planarBlur, buffers.planarDst) != 0)
+    {
+        return -1;
+    }
+    return planarToBgr(buffers.planarDst, dst);
+}
+
+/**
+ * @brief Convolve an image with a custom kernel, letting the calibrated cost model pick the method.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image, saturated from the floating point result.
+ * @param kernel The CV_32FC1 kernel.
+ * @param pool The worker's pool for the floating point temporary.
+ * @return 0 if successful, -1 if error.
+ */
+static int convolveInto(const cv::Mat &src, cv::Mat &dst, const cv::Mat &kernel, FramePool &pool)
+{
+    PooledMat response(pool, src.rows, src.cols, CV_32FC3);
+    if (convolve2D(src, response.get(), kernel) != 0)
+    {
+        return -1;
+    }
+    response.get().convertTo(dst, CV_8U);
+    return 0;
+}
+
+/**
+ * @brief Apply one filter of the chain.
+ *
+ * @param stage The filter.
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image, never the same as src.
+ * @param buffers The worker's buffers and pool for temporaries.
+ * @return 0 if successful, -1 if error.
+ */
+static int applyStage(const FilterStage &stage, cv::Mat &src, cv::Mat &dst, WorkerBuffers &buffers)
+{
+    FramePool &pool = buffers.pool;
+
+    if (stage.name == "grey")
+        return greyscaleInto(src, dst);
+    if (stage.name == "sepia")
+        return sepiaToneInto(src, dst);
+    if (stage.name == "blur")
+        return blur5x5_2Into(src, dst, pool);
+    if (stage.name == "magnitude")
+        return magnitudeInto(src, dst, pool);
+    if (stage.name == "edges")
+        return planarEdges(src, dst, buffers);
+    if (stage.name == "brightness")
+        return adjustBrightnessInto(src, dst, stage.hasParam ? stage.param : 1.2);
+    if (stage.name == "negative")
+        return negativeFilterInto(src, dst);
+    if (stage.name == "quantize")
+        return blurQuantize(src, dst, stage.hasParam ? (int)stage.param : 10);
+    if (stage.name == "cartoon")
+        return bilateralQuantize(src, dst, stage.hasParam ? (int)stage.param : 10);
+    if (stage.name == "median")
+        return medianFilter(src, dst, stage.hasParam ? (int)stage.param : 2);
+    if (stage.name == "clahe")
+        return equalizeClahe(src, dst, stage.hasParam ? (float)stage.param : 2.0f);
+    if (stage.name == "convolve")
+        return convolveInto(src, dst, stage.kernel, pool);
+    return -1;
+}
+
+/**
+ * @brief Run the whole chain on an image, alternating between the worker's two buffers.
+ *
+ * @param stages The filter chain.
+ * @param item The image, replaced by the result.
+ * @param buffers The worker's buffers.
+ * @return 0 if successful, -1 if error.
+ */
+static int applyChain(const std::vector<FilterStage> &stages, BatchItem &item, WorkerBuffers &buffers)
+{
+    // Temporaries of a different shape will not be needed again
+    if (item.image.size() != buffers.lastSize)
+    {
+        buffers.pool.clear();
+        buffers.lastSize = item.image.size();
+    }
+
+    cv::Mat *current = &item.image;
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        cv::Mat *next = current == &buffers.ping ? &buffers.pong : &buffers.ping;
+
+        // The Into filters write into a preallocated image. This only allocates when the size changes.
+        next->create(current->size(), CV_8UC3);
+        if (applyStage(stages[i], *current, *next, buffers) != 0)
+        {
+            return -1;
+        }
+        current = next;
+    }
+
+    // Hand the result to the encoder. The buffer it came from is reallocated for the next image while the other one
+    // keeps being reused.
+    if (current != &item.image)
+    {
+        item.image = *current;
+        current->release();
+    }
+    return 0;
+}
+
+/**
+ * @brief Check whether a file name has one of the image extensions the match tools read.
+ */
+static bool isImageFile(const char *name)
+{
+    return strstr(name, ".jpg") || strstr(name, ".png") || strstr(name, ".ppm") || strstr(name, ".tif");
+}
+
+/**
+ * @brief Pick the output file name of an image so that no two inputs of a run write the same file.
+ *
+ * "photo.png" becomes "photo.jpg". If another input already took that name, e.g. "photo.jpg", the extension is kept in
+ * the name ("photo_png.jpg"), and a counter is added if that is taken as well.
+ *
+ * @param name The input file name.
+ * @param used The output names given out so far.
+ * @return The output file name.
+ */
+static std::string outputName(const std::string &name, std::set<std::string> &used)
+{
+    size_t dot = name.find_last_of('.');
+    std::string stem = name.substr(0, dot);
+    std::string output = stem + ".jpg";
+    if (used.insert(output).second)
+    {
+        return output;
+    }
+
+    if (dot != std::string::npos)
+    {
+        stem += "_" + name.substr(dot + 1);
+    }
+    output = stem + ".jpg";
+    for (int n = 1; !used.insert(output).second; n++)
+    {
+        output = stem + "_" + std::to_string(n) + ".jpg";
+    }
+    return output;
+}
+
+/**
+ * @brief Print the number of images through each stage and the throughput so far.
+ */
+static void printProgress(const BatchProgress &progress, double seconds, bool done)
+{
+    int written = progress.written;
+    printf("\rlisted %d  decoded %d  filtered %d  written %d  failed %d  %.1f images/s%s", (int)progress.listed,
+           (int)progress.decoded, (int)progress.filtered, written, (int)progress.failed,
+           seconds > 0 ? written / seconds : 0.0, done ? "\n" : "");
+    fflush(stdout);
+}
+
+/**
+ * @brief Main function to apply a filter chain to a directory of images
+ *
+ * Reader threads read and decode the files listed by the main thread, worker threads apply the filter chain and encoder
+ * threads write JPEG files to the output directory. Every queue between two stages is bounded, so at most a few images
+ * per thread are in memory at any time regardless of the size of the directory.
+ *
+ * @param argc The number of command line arguments
+ * @param argv The command line arguments
+ * @return int The exit status
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        printf("Usage: %s <inputDirectory> <outputDirectory> <filterChain> [jpegQuality] [threads]\n", argv[0]);
+        printf("Filter chain: comma separated list of %s\n", FILTER_NAMES);
+        printf("Example: %s ./sample_images ./filtered clahe,blur,quantize:8 90\n", argv[0]);
+        exit(-1);
+    }
+
+    printf("\n\n========== Batch Filter ==========\n\n");
+
+    std::string inputDir = argv[1];
+    std::string outputDir = argv[2];
+    std::vector<FilterStage> stages;
+    if (parseChain(argv[3], stages) != 0 || stages.empty())
+    {
+        printf("Invalid filter chain: %s\n", argv[3]);
+        printf("Filters: %s\n", FILTER_NAMES);
+        return -1;
+    }
+
+    // Load or calibrate the convolution cost model now rather than in the middle of the first worker's image
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        if (stages[i].name == "convolve")
+        {
+            convolveCost();
+            break;
+        }
+    }
+
+    int quality = argc > 4 ? atoi(argv[4]) : 95;
+    if (quality < 0 || quality > 100)
+    {
+        printf("Invalid JPEG quality: %d\n", quality);
+        return -1;
+    }
+
+    int threads = argc > 5 ? atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+    threads = std::max(threads, 1);
+
+    // Decoding and encoding JPEGs is about as expensive as a short chain, so give them a quarter of the threads each
+    const int workers = threads;
+    const int readers = std::max(1, threads / 4);
+    const int encoders = std::max(1, threads / 4);
+
+    // Images are processed one per thread, so keep OpenCV and the parallel filters from starting threads of their own
+    cv::setNumThreads(1);
+
+    DIR *dirp = opendir(inputDir.c_str());
+    if (dirp == NULL)
+    {
+        printf("Cannot open directory %s\n", inputDir.c_str());
+        return -1;
+    }
+    if (mkdir(outputDir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        printf("Cannot create directory %s\n", outputDir.c_str());
+        closedir(dirp);
+        return -1;
+    }
+
+    printf("Input directory: %s\n", inputDir.c_str());
+    printf("Output directory: %s\n", outputDir.c_str());
+    printf("Filter chain: %s\n", argv[3]);
+    printf("JPEG quality: %d\n", quality);
+    printf("Threads: %d readers, %d workers, %d encoders\n\n", readers, workers, encoders);
+
+    // Capacities bound the number of decoded images in flight
+    BoundedQueue<BatchItem> paths(1024);
+    BoundedQueue<BatchItem> decoded(2 * workers);
+    BoundedQueue<BatchItem> filtered(2 * workers);
+
+    BatchProgress progress;
+    progress.listed = 0;
+    progress.decoded = 0;
+    progress.filtered = 0;
+    progress.written = 0;
+    progress.failed = 0;
+    progress.finished = false;
+
+    std::vector<std::thread> readerThreads, workerThreads, encoderThreads;
+
+    for (int i = 0; i < readers; i++)
+    {
+        readerThreads.push_back(std::thread([&] {
+            BatchItem item;
+            std::vector<uchar> bytes;
+            while (paths.pop(item))
+            {
+                std::ifstream file((inputDir + "/" + item.name).c_str(), std::ios::binary);
+                bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+                if (!bytes.empty())
+                {
+                    item.image = cv::imdecode(bytes, cv::IMREAD_COLOR);
+                }
+                if (item.image.empty())
+                {
+                    printf("\nNo image data: %s\n", item.name.c_str());
+                    progress.failed++;
+                    continue;
+                }
+                progress.decoded++;
+                decoded.push(item);
+            }
+        }));
+    }
+
+    for (int i = 0; i < workers; i++)
+    {
+        workerThreads.push_back(std::thread([&] {
+            WorkerBuffers buffers;
+            BatchItem item;
+            while (decoded.pop(item))
+            {
+                if (applyChain(stages, item, buffers) != 0)
+                {
+                    printf("\nFilter chain failed: %s\n", item.name.c_str());
+                    progress.failed++;
+                    continue;
+                }
+                progress.filtered++;
+                filtered.push(item);
+            }
+        }));
+    }
+
+    for (int i = 0; i < encoders; i++)
+    {
+        encoderThreads.push_back(std::thread([&] {
+            std::vector<int> params;
+            params.push_back(cv::IMWRITE_JPEG_QUALITY);
+            params.push_back(quality);
+
+            BatchItem item;
+            while (filtered.pop(item))
+            {
+                if (!cv::imwrite(outputDir + "/" + item.output, item.image, params))
+                {
+                    printf("\nCannot write %s\n", item.output.c_str());
+                    progress.failed++;
+                    continue;
+                }
+                progress.written++;
+            }
+        }));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread reporter([&] {
+        // Wake up often so the report does not hold up the exit, print once a second
+        for (int ticks = 1; !progress.finished; ticks++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (ticks % 10 == 0)
+            {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printProgress(progress, seconds, false);
+            }
+        }
+    });
+
+    // List the directory. push() blocks once the readers fall 1024 files behind.
+    std::set<std::string> outputs;
+    struct dirent *dp;
+    while ((dp = readdir(dirp)) != NULL)
+    {
+        if (isImageFile(dp->d_name))
+        {
+            BatchItem item;
+            item.name = dp->d_name;
+            item.output = outputName(item.name, outputs);
+            progress.listed++;
+            paths.push(item);
+        }
+    }
+    closedir(dirp);
+
+    // Shut the pipeline down one stage at a time so every queued image is finished
+    paths.close();
+    for (size_t i = 0; i < readerThreads.size(); i++)
+    {
+        readerThreads[i].join();
+    }
+    decoded.close();
+    for (size_t i = 0; i < workerThreads.size(); i++)
+    {
+        workerThreads[i].join();
+    }
+    filtered.close();
+    for (size_t i = 0; i < encoderThreads.size(); i++)
+    {
+        encoderThreads[i].join();
+    }
+    progress.finished = true;
+    reporter.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printProgress(progress, seconds, true);
+    printf("\nProcessed %d images in %.2f s (%.1f images/s)\n", (int)progress.written, seconds,
+           seconds > 0 ? progress.written / seconds : 0.0);
+    printf("Terminating\n\n");
+
+    return progress.failed > 0 ? 1 : 0;
+}
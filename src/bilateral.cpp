@@ -0,0 +1,198 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Edge preserving smoothing with a bilateral grid.
+
+#include <algorithm>
+#include <cstdio>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "bilateral.h"
+
+// Empty cells kept around the grid so the blur and the trilinear lookups never need bounds checks
+static const int PAD = 2;
+
+/**
+ * @brief Intensity of a BGR pixel used for the range axis of the grid.
+ */
+static inline float intensity(const uchar *pixel)
+{
+    return 0.114f * pixel[0] + 0.587f * pixel[1] + 0.299f * pixel[2];
+}
+
+/**
+ * @brief Blur the grid along one axis with a [1 2 1] kernel.
+ *
+ * Cells hold 4 floats (blue, green, red, weight) with the intensity axis innermost.
+ *
+ * @param grid The grid, blurred in place.
+ * @param temp A buffer the size of the grid.
+ * @param width The number of cells along x.
+ * @param height The number of cells along y.
+ * @param depth The number of cells along intensity.
+ * @param step The distance in floats between neighbouring cells along the axis.
+ */
+static void blurAxis(std::vector<float> &grid, std::vector<float> &temp, int width, int height, int depth, int step)
+{
+    const int rowFloats = width * depth * 4;
+
+    // Within a row the kernel only runs where both neighbours exist. The skipped cells are padding and stay empty.
+    const int begin = step < rowFloats ? step : 0;
+    const int end = step < rowFloats ? rowFloats - step : rowFloats;
+
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &range) {
+        for (int gy = range.start; gy < range.end; gy++)
+        {
+            const float *ptr = grid.data() + (size_t)gy * rowFloats;
+            float *ptrTemp = temp.data() + (size_t)gy * rowFloats;
+
+            if (step >= rowFloats && (gy == 0 || gy == height - 1))
+            {
+                std::copy(ptr, ptr + rowFloats, ptrTemp);
+                continue;
+            }
+
+            std::copy(ptr, ptr + begin, ptrTemp);
+            std::copy(ptr + end, ptr + rowFloats, ptrTemp + end);
+            for (int i = begin; i < end; i++)
+            {
+                ptrTemp[i] = 0.25f * ptr[i - step] + 0.5f * ptr[i] + 0.25f * ptr[i + step];
+            }
+        }
+    });
+
+    grid.swap(temp);
+}
+
+/**
+ * @brief Approximate a bilateral filter on a color image using a bilateral grid.
+ *
+ * The pixels are splatted into a downsampled 3D grid over (x, y, intensity) with cells of sigmaSpace x sigmaSpace
+ * pixels and sigmaRange intensity levels, the grid is blurred with a separable [1 2 1] kernel along each axis and the
+ * result is sliced back out with trilinear interpolation. Pixels across a strong edge land in different intensity
+ * cells, so they do not get averaged together. The cost is roughly linear in the number of pixels and does not depend
+ * on sigmaSpace. Splatting, blurring and slicing are split across threads.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The destination image.
+ * @param sigmaSpace The spatial extent of the filter in pixels, at least 1.
+ * @param sigmaRange The range extent of the filter in intensity levels, at least 1.
+ * @return 0 if successful, -1 if error.
+ */
+int bilateralGrid(const cv::Mat &src, cv::Mat &dst, float sigmaSpace, float sigmaRange)
+{
+    if (src.empty() || src.type() != CV_8UC3)
+    {
+        printf("Frame is empty or not CV_8UC3\n");
+        return -1;
+    }
+
+    if (sigmaSpace < 1.0f || sigmaRange < 1.0f)
+    {
+        printf("Bilateral sigmas must be at least 1\n");
+        return -1;
+    }
+
+    if (dst.data == src.data)
+    {
+        cv::Mat copy = src.clone();
+        return bilateralGrid(copy, dst, sigmaSpace, sigmaRange);
+    }
+
+    const int width = (int)((src.cols - 1) / sigmaSpace) + 1 + 2 * PAD;
+    const int height = (int)((src.rows - 1) / sigmaSpace) + 1 + 2 * PAD;
+    const int depth = (int)(255.0f / sigmaRange) + 1 + 2 * PAD;
+    const int rowFloats = width * depth * 4;
+
+    std::vector<float> grid((size_t)height * rowFloats, 0.0f);
+    std::vector<float> temp(grid.size());
+
+    // Splat. Each pixel goes to its nearest cell. Threads own disjoint ranges of grid rows, so no two threads write the
+    // same cell.
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &range) {
+        int yStart = std::max(0, (int)((range.start - PAD - 0.5f) * sigmaSpace));
+        int yEnd = std::min(src.rows, (int)((range.end - PAD + 0.5f) * sigmaSpace) + 1);
+        for (int y = yStart; y < yEnd; y++)
+        {
+            int gy = (int)(y / sigmaSpace + 0.5f) + PAD;
+            if (gy < range.start || gy >= range.end)
+            {
+                continue;
+            }
+
+            const uchar *ptr = src.ptr<uchar>(y);
+            float *ptrGrid = grid.data() + (size_t)gy * rowFloats;
+            for (int x = 0; x < src.cols; x++)
+            {
+                const uchar *pixel = ptr + 3 * x;
+                int gx = (int)(x / sigmaSpace + 0.5f) + PAD;
+                int gz = (int)(intensity(pixel) / sigmaRange + 0.5f) + PAD;
+                float *cell = ptrGrid + (gx * depth + gz) * 4;
+                cell[0] += pixel[0];
+                cell[1] += pixel[1];
+                cell[2] += pixel[2];
+                cell[3] += 1.0f;
+            }
+        }
+    });
+
+    // Blur along intensity, x and y
+    blurAxis(grid, temp, width, height, depth, 4);
+    blurAxis(grid, temp, width, height, depth, depth * 4);
+    blurAxis(grid, temp, width, height, depth, rowFloats);
+
+    // Slice with trilinear interpolation
+    dst.create(src.size(), CV_8UC3);
+
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++)
+        {
+            const uchar *ptr = src.ptr<uchar>(y);
+            uchar *ptrDst = dst.ptr<uchar>(y);
+
+            float fy = y / sigmaSpace + PAD;
+            int gy = (int)fy;
+            float wy = fy - gy;
+
+            for (int x = 0; x < src.cols; x++)
+            {
+                const uchar *pixel = ptr + 3 * x;
+                float fx = x / sigmaSpace + PAD;
+                float fz = intensity(pixel) / sigmaRange + PAD;
+                int gx = (int)fx;
+                int gz = (int)fz;
+                float wx = fx - gx;
+                float wz = fz - gz;
+
+                float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                for (int dy = 0; dy < 2; dy++)
+                {
+                    for (int dx = 0; dx < 2; dx++)
+                    {
+                        const float *cell = grid.data() + (size_t)(gy + dy) * rowFloats + ((gx + dx) * depth + gz) * 4;
+                        float w = (dy ? wy : 1.0f - wy) * (dx ? wx : 1.0f - wx);
+                        for (int k = 0; k < 4; k++)
+                        {
+                            sum[k] += w * ((1.0f - wz) * cell[k] + wz * cell[k + 4]);
+                        }
+                    }
+                }
+
+                if (sum[3] <= 0.0f)
+                {
+                    ptrDst[3 * x] = pixel[0];
+                    ptrDst[3 * x + 1] = pixel[1];
+                    ptrDst[3 * x + 2] = pixel[2];
+                    continue;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    ptrDst[3 * x + k] = cv::saturate_cast<uchar>(sum[k] / sum[3] + 0.5f);
+                }
+            }
+        }
+    });
+
+    return 0;
+}
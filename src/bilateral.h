@@ -0,0 +1,28 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Edge preserving smoothing with a bilateral grid.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#ifndef BILATERAL_H
+#define BILATERAL_H
+
+/**
+ * @brief Approximate a bilateral filter on a color image using a bilateral grid.
+ *
+ * The pixels are splatted into a downsampled 3D grid over (x, y, intensity) with cells of sigmaSpace x sigmaSpace
+ * pixels and sigmaRange intensity levels, the grid is blurred with a separable [1 2 1] kernel along each axis and the
+ * result is sliced back out with trilinear interpolation. Pixels across a strong edge land in different intensity
+ * cells, so they do not get averaged together. The cost is roughly linear in the number of pixels and does not depend
+ * on sigmaSpace. Splatting, blurring and slicing are split across threads.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The destination image.
+ * @param sigmaSpace The spatial extent of the filter in pixels, at least 1.
+ * @param sigmaRange The range extent of the filter in intensity levels, at least 1.
+ * @return 0 if successful, -1 if error.
+ */
+int bilateralGrid(const cv::Mat &src, cv::Mat &dst, float sigmaSpace, float sigmaRange);
+
+#endif
@@ -0,0 +1,97 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: A blocking queue with a fixed capacity used to connect the stages of the multithreaded pipelines.
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+/**
+ * @brief A thread safe FIFO queue that holds at most a fixed number of items.
+ *
+ * push() blocks while the queue is full, so a fast producer can never run more than capacity items ahead of its
+ * consumers, which bounds the memory of a pipeline. Once close() is called pop() drains the remaining items and then
+ * returns false.
+ */
+template <typename T> class BoundedQueue
+{
+  public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false)
+    {
+    }
+
+    /**
+     * @brief Add an item, waiting for room if the queue is full.
+     *
+     * @param item The item. It is moved into the queue.
+     * @return true if the item was added, false if the queue was closed.
+     */
+    bool push(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed)
+        {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item, waiting for one if the queue is empty.
+     *
+     * @param item The removed item.
+     * @return true if an item was removed, false if the queue is closed and empty.
+     */
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty())
+        {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Stop accepting items and wake every waiting thread.
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    /**
+     * @brief Get the number of items currently in the queue.
+     */
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+  private:
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+
+    const size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+#endif
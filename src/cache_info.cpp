@@ -0,0 +1,79 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Detect the data cache sizes of the machine so filters can size their tiles to fit in cache.
+
+#include <algorithm>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+
+#include "cache_info.h"
+
+/**
+ * @brief Query a cache size from the operating system.
+ *
+ * @param level 1 for the L1 data cache, 2 for the L2 cache.
+ * @return long The size in bytes, or 0 if it is unknown.
+ */
+static long queryCacheSize(int level)
+{
+#ifdef __APPLE__
+    long long size = 0;
+    size_t length = sizeof(size);
+    const char *name = level == 1 ? "hw.l1dcachesize" : "hw.l2cachesize";
+    if (sysctlbyname(name, &size, &length, NULL, 0) != 0)
+    {
+        return 0;
+    }
+    return (long)size;
+#elif defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long size = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : _SC_LEVEL2_CACHE_SIZE);
+    return size > 0 ? size : 0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Get the size of the L1 data cache in bytes. Falls back to 32 KB if it cannot be detected.
+ */
+int cacheSizeL1()
+{
+    static const long size = queryCacheSize(1);
+    return size > 0 ? (int)size : 32 * 1024;
+}
+
+/**
+ * @brief Get the size of the L2 cache in bytes. Falls back to 256 KB if it cannot be detected.
+ */
+int cacheSizeL2()
+{
+    static const long size = queryCacheSize(2);
+    return size > 0 ? (int)size : 256 * 1024;
+}
+
+/**
+ * @brief Pick the width in pixels of the column strips used by tiled filters.
+ *
+ * The strip is sized so that its working set (bytesPerPixel bytes per pixel of strip width) takes half of the L1 data
+ * cache. If that gives a very narrow strip, half of L2 is used instead.
+ *
+ * @param bytesPerPixel The number of bytes the filter keeps in cache per pixel of strip width.
+ * @return int The strip width in pixels, at least 64.
+ */
+int tileStripWidth(int bytesPerPixel)
+{
+    const int minWidth = 64;
+    bytesPerPixel = std::max(bytesPerPixel, 1);
+
+    int width = cacheSizeL1() / 2 / bytesPerPixel;
+    if (width < minWidth)
+    {
+        width = cacheSizeL2() / 2 / bytesPerPixel;
+    }
+
+    // Keep strips a multiple of 16 pixels so they start on vector boundaries
+    return std::max(minWidth, width / 16 * 16);
+}
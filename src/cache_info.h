@@ -0,0 +1,29 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Detect the data cache sizes of the machine so filters can size their tiles to fit in cache.
+
+#ifndef CACHE_INFO_H
+#define CACHE_INFO_H
+
+/**
+ * @brief Get the size of the L1 data cache in bytes. Falls back to 32 KB if it cannot be detected.
+ */
+int cacheSizeL1();
+
+/**
+ * @brief Get the size of the L2 cache in bytes. Falls back to 256 KB if it cannot be detected.
+ */
+int cacheSizeL2();
+
+/**
+ * @brief Pick the width in pixels of the column strips used by tiled filters.
+ *
+ * The strip is sized so that its working set (bytesPerPixel bytes per pixel of strip width) takes half of the L1 data
+ * cache. If that gives a very narrow strip, half of L2 is used instead.
+ *
+ * @param bytesPerPixel The number of bytes the filter keeps in cache per pixel of strip width.
+ * @return int The strip width in pixels, at least 64.
+ */
+int tileStripWidth(int bytesPerPixel);
+
+#endif
@@ -15,24 +15,8 @@
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include "kmeans.h"
-
-/*
-  Given a pixel and an array of pixels, returns the closest color in the array
- */
-cv::Vec3b closestColor( cv::Vec3b &pix, std::vector<cv::Vec3b> &colors ) {
-  int mincolor = 0;
-  int mindist = SSD( pix, colors[0] );
-
-  for(int i=1;i<colors.size();i++) {
-    int sse = SSD( pix, colors[i] );
-    if( sse < mindist ) {
-      mindist = sse;
-      mincolor = i;
-    }
-  }
-
-  return( colors[mincolor] );
-}
+#include "nearest_color.h"
+#include "quantize.h"
 
 // Main function looks for a command line argument with the image filename and # of colors
 int main(int argc, char *argv[]) {
@@ -41,10 +25,19 @@ int main(int argc, char *argv[]) {
   cv::Mat dst;  // viewing image
   char filename[256];
   int ncolors = 16;
+  int method = 0;
 
   // error checking
   if(argc < 3) {
-    printf("usage: %s <image filename> <# of colors>\n", argv[0]);
+    printf("usage: %s <image filename> <# of colors> [method]\n", argv[0]);
+    printf("method: 0 for k-means (default), 1 for median cut, 2 for octree\n");
+    return(-1);
+  }
+  if( argc > 3 ) {
+    method = atoi( argv[3] );
+  }
+  if( method < 0 || method > 2 ) {
+    printf("error: method must be 0, 1 or 2\n");
     return(-1);
   }
 
@@ -68,32 +61,44 @@ int main(int argc, char *argv[]) {
     ncolors = tcolors;
   }
 
-  // sample colors from the image using jitter sampling
-  // sample one color from each B x B block of the image
-  int B = 4;
-  std::vector<cv::Vec3b> data;
-  for(int i=0;i<src.rows - B;i += B) {
-    for(int j=0;j<src.cols - B;j += B) {
-      int jx = rand() % B;
-      int jy = rand() % B;
-      data.push_back( src.at<cv::Vec3b>(i+jy, j+jx) );
+  std::vector<cv::Vec3b> means;
+  int *labels = NULL;
+
+  if( method == 1 || method == 2 ) {
+    // median cut and octree build the palette from a color histogram of every pixel, without iterations
+    if( (method == 1 ? medianCutPalette( src, means, ncolors ) : octreePalette( src, means, ncolors )) ) {
+      printf("Error building the palette\n");
+      return(-1);
     }
   }
+  else {
+    // sample colors from the image using jitter sampling
+    // sample one color from each B x B block of the image
+    int B = 4;
+    std::vector<cv::Vec3b> data;
+    for(int i=0;i<src.rows - B;i += B) {
+      for(int j=0;j<src.cols - B;j += B) {
+        int jx = rand() % B;
+        int jy = rand() % B;
+        data.push_back( src.at<cv::Vec3b>(i+jy, j+jx) );
+      }
+    }
 
-  std::vector<cv::Vec3b> means;
-  int *labels = new int[data.size()];
+    labels = new int[data.size()];
 
-  if(kmeans( data, means, labels, ncolors ) ) {
-    printf("Erro using kmeans\n");
-    return(-1);
+    if(kmeans( data, means, labels, ncolors ) ) {
+      printf("Erro using kmeans\n");
+      return(-1);
+    }
   }
 
-  // kmeans should give a set of means (ncolors of them)
-  dst.create( src.size(), src.type() );
-  for(int i=0;i<src.rows;i++) {
-    for(int j=0;j<src.cols;j++) {
-      dst.at<cv::Vec3b>(i,j) = closestColor( src.at<cv::Vec3b>(i,j), means );
-    }
+  // the palette is a set of means (at most ncolors of them)
+  // map every pixel to its closest mean by SSD with a lookup in a color cube of the means, at a cost per pixel that
+  // does not depend on ncolors
+  PaletteLut lut;
+  if( buildPaletteLut( means, lut ) || remapPaletteLut( src, dst, lut ) ) {
+    printf("Error mapping the image to the means\n");
+    return(-1);
   }
 
   cv::imshow("clustered", dst );
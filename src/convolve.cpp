@@ -0,0 +1,476 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: General 2D convolution with arbitrary kernels. Picks between a direct, a separable and an FFT implementation
+// with a cost model that is calibrated on this machine the first time it is needed.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "convolve.h"
+
+// Singular values below this fraction of the largest one are treated as 0 when counting separable terms
+static const double RANK_TOLERANCE = 1e-6;
+
+/**
+ * @brief Split a kernel into a sum of outer products of a column and a row vector.
+ *
+ * @param kernel The CV_32FC1 kernel.
+ * @param columns The vertical taps of each term.
+ * @param rows The horizontal taps of each term.
+ * @return int The number of terms, which is the rank of the kernel.
+ */
+static int separableTerms(const cv::Mat &kernel, std::vector<std::vector<float>> &columns,
+                          std::vector<std::vector<float>> &rows)
+{
+    cv::Mat k64, w, u, vt;
+    kernel.convertTo(k64, CV_64F);
+    cv::SVD::compute(k64, w, u, vt);
+
+    columns.clear();
+    rows.clear();
+    for (int t = 0; t < w.rows; t++)
+    {
+        double sigma = w.at<double>(t);
+        if (sigma <= w.at<double>(0) * RANK_TOLERANCE)
+        {
+            break;
+        }
+
+        // Share the singular value between the two passes
+        double scale = std::sqrt(sigma);
+        std::vector<float> column(kernel.rows), row(kernel.cols);
+        for (int i = 0; i < kernel.rows; i++)
+        {
+            column[i] = static_cast<float>(u.at<double>(i, t) * scale);
+        }
+        for (int j = 0; j < kernel.cols; j++)
+        {
+            row[j] = static_cast<float>(vt.at<double>(t, j) * scale);
+        }
+        columns.push_back(column);
+        rows.push_back(row);
+    }
+
+    return static_cast<int>(columns.size());
+}
+
+/**
+ * @brief Size of the transforms used by the FFT path along one axis.
+ *
+ * @param padded The padded image length along the axis.
+ * @param kernel The kernel length along the axis.
+ * @return int The transform length. Each output tile covers transform - kernel + 1 pixels.
+ */
+static int fftLength(int padded, int kernel)
+{
+    return cv::getOptimalDFTSize(std::min(padded, std::max(CONVOLVE_FFT_TILE, 2 * kernel)));
+}
+
+/**
+ * @brief Work done by each method, in the units of ConvolveCost.
+ */
+static double directWork(cv::Size size, int channels, cv::Size ksize)
+{
+    return (double)size.area() * channels * ksize.area();
+}
+
+static double separableWork(cv::Size size, int channels, cv::Size ksize, int rank)
+{
+    return (double)size.area() * channels * rank * (ksize.width + ksize.height);
+}
+
+static double fftWork(cv::Size size, int channels, cv::Size ksize)
+{
+    int dh = fftLength(size.height + ksize.height - 1, ksize.height);
+    int dw = fftLength(size.width + ksize.width - 1, ksize.width);
+    int tilesY = (size.height + dh - ksize.height) / (dh - ksize.height + 1);
+    int tilesX = (size.width + dw - ksize.width) / (dw - ksize.width + 1);
+
+    // A forward and an inverse transform per tile and channel
+    double points = (double)dh * dw;
+    return 2.0 * tilesY * tilesX * channels * points * std::log2(points);
+}
+
+/**
+ * @brief Correlate a padded plane with a kernel by looping over every tap.
+ *
+ * @param padded The CV_32FC1 plane padded by the kernel size - 1.
+ * @param dst The CV_32FC1 destination plane.
+ * @param kernel The CV_32FC1 kernel.
+ */
+static void convolveDirect(const cv::Mat &padded, cv::Mat &dst, const cv::Mat &kernel)
+{
+    cv::parallel_for_(cv::Range(0, dst.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++)
+        {
+            float *ptrDst = dst.ptr<float>(y);
+            std::fill(ptrDst, ptrDst + dst.cols, 0.0f);
+
+            // One tap at a time over the whole row keeps the inner loop unit stride
+            for (int i = 0; i < kernel.rows; i++)
+            {
+                const float *ptr = padded.ptr<float>(y + i);
+                const float *taps = kernel.ptr<float>(i);
+                for (int j = 0; j < kernel.cols; j++)
+                {
+                    const float tap = taps[j];
+                    if (tap == 0.0f)
+                    {
+                        continue;
+                    }
+                    for (int x = 0; x < dst.cols; x++)
+                    {
+                        ptrDst[x] += tap * ptr[x + j];
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Correlate a padded plane with a kernel given as a sum of separable terms.
+ *
+ * @param padded The CV_32FC1 plane padded by the kernel size - 1.
+ * @param dst The CV_32FC1 destination plane.
+ * @param columns The vertical taps of each term.
+ * @param rows The horizontal taps of each term.
+ */
+static void convolveSeparable(const cv::Mat &padded, cv::Mat &dst, const std::vector<std::vector<float>> &columns,
+                              const std::vector<std::vector<float>> &rows)
+{
+    const int kh = static_cast<int>(columns[0].size());
+    const int kw = static_cast<int>(rows[0].size());
+
+    cv::parallel_for_(cv::Range(0, dst.rows), [&](const cv::Range &range) {
+        std::vector<float> column(padded.cols);
+        for (int y = range.start; y < range.end; y++)
+        {
+            float *ptrDst = dst.ptr<float>(y);
+            std::fill(ptrDst, ptrDst + dst.cols, 0.0f);
+
+            for (size_t t = 0; t < columns.size(); t++)
+            {
+                // Vertical pass into the row buffer
+                std::fill(column.begin(), column.end(), 0.0f);
+                for (int i = 0; i < kh; i++)
+                {
+                    const float tap = columns[t][i];
+                    const float *ptr = padded.ptr<float>(y + i);
+                    for (int x = 0; x < padded.cols; x++)
+                    {
+                        column[x] += tap * ptr[x];
+                    }
+                }
+
+                // Horizontal pass over the row buffer
+                for (int j = 0; j < kw; j++)
+                {
+                    const float tap = rows[t][j];
+                    const float *ptr = column.data() + j;
+                    for (int x = 0; x < dst.cols; x++)
+                    {
+                        ptrDst[x] += tap * ptr[x];
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Correlate a padded plane with a kernel by multiplying spectra, one output tile at a time.
+ *
+ * Every output tile is computed from its own block of the padded plane plus the kernel overlap (overlap-save), so the
+ * tiles are independent and run in parallel.
+ *
+ * @param padded The CV_32FC1 plane padded by the kernel size - 1.
+ * @param dst The CV_32FC1 destination plane.
+ * @param kernelSpectrum The spectrum of the kernel zero padded to the transform size.
+ * @param ksize The kernel size.
+ */
+static void convolveFFT(const cv::Mat &padded, cv::Mat &dst, const cv::Mat &kernelSpectrum, cv::Size ksize)
+{
+    const int dh = kernelSpectrum.rows;
+    const int dw = kernelSpectrum.cols;
+    const int tileH = dh - ksize.height + 1;
+    const int tileW = dw - ksize.width + 1;
+    const int tilesY = (dst.rows + tileH - 1) / tileH;
+    const int tilesX = (dst.cols + tileW - 1) / tileW;
+
+    cv::parallel_for_(cv::Range(0, tilesY * tilesX), [&](const cv::Range &range) {
+        cv::Mat block(dh, dw, CV_32F), spectrum, result;
+        for (int t = range.start; t < range.end; t++)
+        {
+            cv::Rect out((t % tilesX) * tileW, (t / tilesX) * tileH, 0, 0);
+            out.width = std::min(tileW, dst.cols - out.x);
+            out.height = std::min(tileH, dst.rows - out.y);
+            cv::Rect in(out.x, out.y, out.width + ksize.width - 1, out.height + ksize.height - 1);
+
+            block.setTo(cv::Scalar(0));
+            padded(in).copyTo(block(cv::Rect(0, 0, in.width, in.height)));
+
+            // Multiplying by the conjugate of the kernel spectrum gives the correlation. The transform is large enough
+            // that the kept part of the result never wraps around.
+            cv::dft(block, spectrum, cv::DFT_COMPLEX_OUTPUT);
+            cv::mulSpectrums(spectrum, kernelSpectrum, spectrum, 0, true);
+            cv::dft(spectrum, result, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+            result(cv::Rect(0, 0, out.width, out.height)).copyTo(dst(out));
+        }
+    });
+}
+
+/**
+ * @brief Convolve with a known method and, for CONVOLVE_SEPARABLE, known separable terms.
+ */
+static int convolveWith(const cv::Mat &src, cv::Mat &dst, const cv::Mat &kernel, int method,
+                        const std::vector<std::vector<float>> &columns, const std::vector<std::vector<float>> &rows)
+{
+    const int ax = kernel.cols / 2;
+    const int ay = kernel.rows / 2;
+
+    cv::Mat srcF;
+    std::vector<cv::Mat> planes;
+    src.convertTo(srcF, CV_32F);
+    cv::split(srcF, planes);
+
+    cv::Mat kernelSpectrum;
+    if (method == CONVOLVE_FFT)
+    {
+        int dh = fftLength(src.rows + kernel.rows - 1, kernel.rows);
+        int dw = fftLength(src.cols + kernel.cols - 1, kernel.cols);
+        cv::Mat kernelPadded = cv::Mat::zeros(dh, dw, CV_32F);
+        kernel.copyTo(kernelPadded(cv::Rect(0, 0, kernel.cols, kernel.rows)));
+        cv::dft(kernelPadded, kernelSpectrum, cv::DFT_COMPLEX_OUTPUT);
+    }
+
+    cv::Mat padded;
+    for (size_t c = 0; c < planes.size(); c++)
+    {
+        cv::copyMakeBorder(planes[c], padded, ay, kernel.rows - 1 - ay, ax, kernel.cols - 1 - ax,
+                           cv::BORDER_REPLICATE);
+
+        // Each plane gets a fresh output so the result never overwrites the padded source
+        planes[c] = cv::Mat(src.rows, src.cols, CV_32F);
+        if (method == CONVOLVE_SEPARABLE)
+        {
+            convolveSeparable(padded, planes[c], columns, rows);
+        }
+        else if (method == CONVOLVE_FFT)
+        {
+            convolveFFT(padded, planes[c], kernelSpectrum, kernel.size());
+        }
+        else
+        {
+            convolveDirect(padded, planes[c], kernel);
+        }
+    }
+
+    cv::merge(planes, dst);
+    return 0;
+}
+
+/**
+ * @brief Pick the cheapest method given the rank of the kernel.
+ */
+static int cheapestMethod(cv::Size size, int channels, cv::Size ksize, int rank)
+{
+    const ConvolveCost &cost = convolveCost();
+    double direct = cost.direct * directWork(size, channels, ksize);
+    double separable = cost.separable * separableWork(size, channels, ksize, rank);
+    double fft = cost.fft * fftWork(size, channels, ksize);
+
+    if (fft < direct && fft < separable)
+    {
+        return CONVOLVE_FFT;
+    }
+    return separable < direct ? CONVOLVE_SEPARABLE : CONVOLVE_DIRECT;
+}
+
+/**
+ * @brief Time each convolution method on a small synthetic image and derive its cost per unit of work.
+ *
+ * @param cost The measured costs.
+ * @return 0 if successful, -1 if error.
+ */
+int calibrateConvolveCost(ConvolveCost &cost)
+{
+    // Large enough for the inner loops to reach steady state, small enough to take well under a second
+    const cv::Size size(256, 256);
+    const int ksize = 15;
+
+    cv::Mat src(size, CV_32FC1), dst;
+    for (int y = 0; y < src.rows; y++)
+    {
+        float *ptr = src.ptr<float>(y);
+        for (int x = 0; x < src.cols; x++)
+        {
+            ptr[x] = static_cast<float>((x * 7 + y * 13) % 256);
+        }
+    }
+
+    // A rank 1 box-like kernel so the separable method has a single term
+    cv::Mat kernel(ksize, ksize, CV_32FC1);
+    for (int i = 0; i < ksize; i++)
+    {
+        for (int j = 0; j < ksize; j++)
+        {
+            kernel.at<float>(i, j) = (1.0f + i % 3) * (1.0f + j % 2) / (ksize * ksize);
+        }
+    }
+
+    std::vector<std::vector<float>> columns, rows;
+    int rank = separableTerms(kernel, columns, rows);
+
+    const int methods[3] = {CONVOLVE_DIRECT, CONVOLVE_SEPARABLE, CONVOLVE_FFT};
+    double seconds[3];
+    for (int m = 0; m < 3; m++)
+    {
+        // Best of a few runs, the first also warms up the thread pool and the caches
+        seconds[m] = 0;
+        for (int run = 0; run < 3; run++)
+        {
+            int64 start = cv::getTickCount();
+            convolveWith(src, dst, kernel, methods[m], columns, rows);
+            double elapsed = (cv::getTickCount() - start) / cv::getTickFrequency();
+            seconds[m] = run == 0 ? elapsed : std::min(seconds[m], elapsed);
+        }
+    }
+
+    cost.direct = seconds[0] / directWork(size, 1, kernel.size());
+    cost.separable = seconds[1] / separableWork(size, 1, kernel.size(), rank);
+    cost.fft = seconds[2] / fftWork(size, 1, kernel.size());
+
+    if (!(cost.direct > 0 && cost.separable > 0 && cost.fft > 0))
+    {
+        printf("Convolution calibration failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Load the cost model from CONVOLVE_COST_FILE, or calibrate it and save it there.
+ */
+static ConvolveCost loadConvolveCost()
+{
+    // Rough costs on a recent desktop, only used if calibration fails
+    ConvolveCost cost = {1e-9, 1e-9, 2e-9};
+
+    FILE *fp = fopen(CONVOLVE_COST_FILE, "r");
+    if (fp != NULL)
+    {
+        ConvolveCost loaded;
+        int read = fscanf(fp, "%lf %lf %lf", &loaded.direct, &loaded.separable, &loaded.fft);
+        fclose(fp);
+        if (read == 3 && loaded.direct > 0 && loaded.separable > 0 && loaded.fft > 0)
+        {
+            return loaded;
+        }
+        printf("Ignoring invalid %s\n", CONVOLVE_COST_FILE);
+    }
+
+    printf("Calibrating convolution cost model ...\n");
+    if (calibrateConvolveCost(cost) != 0)
+    {
+        return cost;
+    }
+
+    fp = fopen(CONVOLVE_COST_FILE, "w");
+    if (fp == NULL)
+    {
+        printf("Unable to save %s\n", CONVOLVE_COST_FILE);
+        return cost;
+    }
+    fprintf(fp, "%.6e %.6e %.6e\n", cost.direct, cost.separable, cost.fft);
+    fclose(fp);
+
+    return cost;
+}
+
+/**
+ * @brief Get the cost model used by CONVOLVE_AUTO.
+ *
+ * The first call loads CONVOLVE_COST_FILE, or runs calibrateConvolveCost and saves the result there if the file does
+ * not exist yet.
+ *
+ * @return The cost model.
+ */
+const ConvolveCost &convolveCost()
+{
+    static const ConvolveCost cost = loadConvolveCost();
+    return cost;
+}
+
+/**
+ * @brief Pick the cheapest method for a convolution according to the cost model.
+ *
+ * @param size The image size.
+ * @param channels The number of image channels.
+ * @param kernel The CV_32FC1 or CV_64FC1 kernel.
+ * @return CONVOLVE_DIRECT, CONVOLVE_SEPARABLE or CONVOLVE_FFT.
+ */
+int chooseConvolveMethod(cv::Size size, int channels, const cv::Mat &kernel)
+{
+    std::vector<std::vector<float>> columns, rows;
+    int rank = separableTerms(kernel, columns, rows);
+    return cheapestMethod(size, channels, kernel.size(), std::max(rank, 1));
+}
+
+/**
+ * @brief Convolve an image with an arbitrary kernel.
+ *
+ * Like cv::filter2D this computes the correlation with the kernel anchored at (kernel.cols / 2, kernel.rows / 2), so
+ * flip the kernel first for a true convolution. Edges are handled by replicating the border pixels. All methods give
+ * the same result up to floating point rounding:
+ * - CONVOLVE_DIRECT loops over every kernel tap.
+ * - CONVOLVE_SEPARABLE splits the kernel with an SVD into as many separable terms as its rank and runs a vertical and a
+ *   horizontal 1D pass per term.
+ * - CONVOLVE_FFT multiplies spectra with cv::dft, one output tile at a time so huge images never need a huge transform.
+ *
+ * @param src The source image, CV_8U or CV_32F with any number of channels.
+ * @param dst The CV_32F destination image with the same number of channels.
+ * @param kernel The CV_32FC1 or CV_64FC1 kernel.
+ * @param method One of ConvolveMethod. CONVOLVE_AUTO picks the cheapest with chooseConvolveMethod.
+ * @return 0 if successful, -1 if error.
+ */
+int convolve2D(const cv::Mat &src, cv::Mat &dst, const cv::Mat &kernel, int method)
+{
+    if (src.empty() || (src.depth() != CV_8U && src.depth() != CV_32F))
+    {
+        printf("Frame is empty or not CV_8U / CV_32F\n");
+        return -1;
+    }
+    if (kernel.empty() || kernel.channels() != 1 || (kernel.depth() != CV_32F && kernel.depth() != CV_64F))
+    {
+        printf("Kernel is empty or not CV_32FC1 / CV_64FC1\n");
+        return -1;
+    }
+
+    cv::Mat kernel32;
+    kernel.convertTo(kernel32, CV_32F);
+
+    std::vector<std::vector<float>> columns, rows;
+    if (method == CONVOLVE_AUTO || method == CONVOLVE_SEPARABLE)
+    {
+        int rank = separableTerms(kernel32, columns, rows);
+        if (rank == 0)
+        {
+            // All zero kernel
+            dst = cv::Mat::zeros(src.size(), CV_MAKETYPE(CV_32F, src.channels()));
+            return 0;
+        }
+        if (method == CONVOLVE_AUTO)
+        {
+            method = cheapestMethod(src.size(), src.channels(), kernel32.size(), rank);
+        }
+    }
+
+    return convolveWith(src, dst, kernel32, method, columns, rows);
+}
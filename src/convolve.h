@@ -0,0 +1,86 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: General 2D convolution with arbitrary kernels. Picks between a direct, a separable and an FFT implementation
+// with a cost model that is calibrated on this machine the first time it is needed.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+// File the calibrated cost model is saved to and loaded from, relative to the working directory.
+#define CONVOLVE_COST_FILE "convolve_cost.txt"
+
+// Output tiles of the FFT path are sized so the transform is about this many points along each axis.
+#define CONVOLVE_FFT_TILE 512
+
+enum ConvolveMethod
+{
+    CONVOLVE_AUTO,
+    CONVOLVE_DIRECT,
+    CONVOLVE_SEPARABLE,
+    CONVOLVE_FFT
+};
+
+/**
+ * @brief Measured cost of each convolution method, in seconds per unit of work.
+ *
+ * A unit is one multiply-add for the direct and separable methods and one n log2(n) step of a transform for the FFT
+ * method.
+ */
+struct ConvolveCost
+{
+    double direct;
+    double separable;
+    double fft;
+};
+
+/**
+ * @brief Time each convolution method on a small synthetic image and derive its cost per unit of work.
+ *
+ * @param cost The measured costs.
+ * @return 0 if successful, -1 if error.
+ */
+int calibrateConvolveCost(ConvolveCost &cost);
+
+/**
+ * @brief Get the cost model used by CONVOLVE_AUTO.
+ *
+ * The first call loads CONVOLVE_COST_FILE, or runs calibrateConvolveCost and saves the result there if the file does
+ * not exist yet.
+ *
+ * @return The cost model.
+ */
+const ConvolveCost &convolveCost();
+
+/**
+ * @brief Pick the cheapest method for a convolution according to the cost model.
+ *
+ * @param size The image size.
+ * @param channels The number of image channels.
+ * @param kernel The CV_32FC1 or CV_64FC1 kernel.
+ * @return CONVOLVE_DIRECT, CONVOLVE_SEPARABLE or CONVOLVE_FFT.
+ */
+int chooseConvolveMethod(cv::Size size, int channels, const cv::Mat &kernel);
+
+/**
+ * @brief Convolve an image with an arbitrary kernel.
+ *
+ * Like cv::filter2D this computes the correlation with the kernel anchored at (kernel.cols / 2, kernel.rows / 2), so
+ * flip the kernel first for a true convolution. Edges are handled by replicating the border pixels. All methods give
+ * the same result up to floating point rounding:
+ * - CONVOLVE_DIRECT loops over every kernel tap.
+ * - CONVOLVE_SEPARABLE splits the kernel with an SVD into as many separable terms as its rank and runs a vertical and a
+ *   horizontal 1D pass per term.
+ * - CONVOLVE_FFT multiplies spectra with cv::dft, one output tile at a time so huge images never need a huge transform.
+ *
+ * @param src The source image, CV_8U or CV_32F with any number of channels.
+ * @param dst The CV_32F destination image with the same number of channels.
+ * @param kernel The CV_32FC1 or CV_64FC1 kernel.
+ * @param method One of ConvolveMethod. CONVOLVE_AUTO picks the cheapest with chooseConvolveMethod.
+ * @return 0 if successful, -1 if error.
+ */
+int convolve2D(const cv::Mat &src, cv::Mat &dst, const cv::Mat &kernel, int method = CONVOLVE_AUTO);
+
+#endif
@@ -138,7 +138,6 @@ int getfloat(FILE *fp, float *v)
  */
 int append_image_data_csv(const char *filename, char *image_filename, std::vector<float> &image_data, int reset_file)
 {
-    char buffer[256];
     char mode[8];
     FILE *fp;
 
@@ -157,8 +156,23 @@ int append_image_data_csv(const char *filename, char *image_filename, std::vecto
     }
 
     // write the filename and the feature vector to the CSV file
-    strcpy(buffer, image_filename);
-    std::fwrite(buffer, sizeof(char), strlen(buffer), fp);
+    write_image_data_row(fp, image_filename, image_data);
+
+    fclose(fp);
+
+    return (0);
+}
+
+/*
+  Writes one line of data in the format of append_image_data_csv to a
+  file that is already open, so a writer can keep the file open over
+  many lines.
+
+  The function returns a non-zero value in case of an error.
+ */
+int write_image_data_row(FILE *fp, const char *image_filename, const std::vector<float> &image_data)
+{
+    std::fwrite(image_filename, sizeof(char), strlen(image_filename), fp);
     for (int i = 0; i < image_data.size(); i++)
     {
         char tmp[256];
@@ -168,9 +182,7 @@ int append_image_data_csv(const char *filename, char *image_filename, std::vecto
 
     std::fwrite("\n", sizeof(char), 1, fp); // EOL
 
-    fclose(fp);
-
-    return (0);
+    return (ferror(fp) ? -1 : 0);
 }
 
 /*
@@ -33,6 +33,15 @@
 int append_image_data_csv(const char *filename, char *image_filename, std::vector<float> &image_data,
                           int reset_file = 0);
 
+/*
+  Writes one line of data in the format of append_image_data_csv to a
+  file that is already open, so a writer can keep the file open over
+  many lines.
+
+  The function returns a non-zero value in case of an error.
+ */
+int write_image_data_row(FILE *fp, const char *image_filename, const std::vector<float> &image_data);
+
 /*
   Given a file with the format of a string as the first column and
   floating point numbers as the remaining columns, this function
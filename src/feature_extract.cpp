@@ -1,66 +1,607 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Extract the feature vector of every image in a directory into a CSV file. Listing, decoding, extraction and
+// writing run as a pipeline of thread pools connected by bounded queues, and the rows are written in listing order. A
+// manifest next to the CSV file lets a re-run extract only the images that are new or changed.
+
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <dirent.h>
-#include <filesystem>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
+#include "bounded_queue.h"
 #include "csv_util.h"
 #include "feature_utils.h"
+#include "index_manifest.h"
+#include "palette_feature.h"
+
+// At most this many images are between the directory listing and the writer, which bounds the rows the writer holds
+// back to restore the listing order
+#define EXTRACT_WINDOW 4096
+
+// What the last run knew about an image
+#define EXTRACT_NEW 0       // not in the manifest, or deleted since
+#define EXTRACT_CHANGED 1   // the content changed, extracted again
+#define EXTRACT_TOUCHED 2   // the modification time changed but the content hash did not, the row is kept
+#define EXTRACT_UNCHANGED 3 // same size and modification time, the row is kept without reading the file
+
+/**
+ * @brief An image travelling through the pipeline.
+ */
+struct ExtractItem
+{
+    long index; // position in the directory listing, the writer writes rows in this order
+    std::string name;
+    cv::Mat image;
+    std::vector<float> featureVector;
+    bool failed;
+    int state;
+    ManifestEntry entry;          // size, modification time and hash for the new manifest
+    const ManifestEntry *previous; // the entry of the last run with a row in the CSV file, NULL if none
+
+    ExtractItem() : index(0), failed(false), state(EXTRACT_NEW), previous(NULL)
+    {
+    }
+
+    /**
+     * @brief Check whether the row of the last run is kept instead of extracting the image.
+     */
+    bool reused() const
+    {
+        return state == EXTRACT_TOUCHED || state == EXTRACT_UNCHANGED;
+    }
+};
+
+/**
+ * @brief The number of images through one stage and the time its threads spent working on them.
+ */
+struct StageCounter
+{
+    std::atomic<int> images;
+    std::atomic<long long> busyNanoseconds; // summed over the threads of the stage, waits on the queues excluded
+    int threads;
+};
+
+/**
+ * @brief Counters shared by all the stages, read by the progress report.
+ */
+struct ExtractProgress
+{
+    StageCounter listed;
+    StageCounter decoded;
+    StageCounter extracted;
+    StageCounter written;
+    std::atomic<int> failed;
+    std::atomic<int> states[4]; // images written by EXTRACT_ state
+    std::atomic<bool> finished;
+};
+
+/**
+ * @brief Measures the time a stage spends on one image.
+ */
+class StageTimer
+{
+  public:
+    explicit StageTimer(StageCounter &counter) : counter(counter), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~StageTimer()
+    {
+        counter.busyNanoseconds +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+  private:
+    StageCounter &counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Reset a stage counter.
+ */
+static void initCounter(StageCounter &counter, int threads)
+{
+    counter.images = 0;
+    counter.busyNanoseconds = 0;
+    counter.threads = threads;
+}
+
+/**
+ * @brief Check whether a file name has one of the image extensions the match tools read.
+ */
+static bool isImageFile(const char *name)
+{
+    return strstr(name, ".jpg") || strstr(name, ".png") || strstr(name, ".ppm") || strstr(name, ".tif");
+}
+
+/**
+ * @brief Read an image file, then decode it unless its content is the same as in the last run.
+ *
+ * @param path The path of the file.
+ * @param flags IMREAD_GRAYSCALE or IMREAD_COLOR.
+ * @param bytes A buffer for the file, reused from one image to the next.
+ * @param item The image. Receives the content hash, and the decoded image or the EXTRACT_TOUCHED state.
+ */
+static void decodeImage(const std::string &path, int flags, std::vector<uchar> &bytes, ExtractItem &item)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    item.entry.hash = contentHash(bytes.empty() ? NULL : &bytes[0], bytes.size());
+
+    if (item.previous != NULL && !bytes.empty() && item.entry.hash == item.previous->hash &&
+        (long long)bytes.size() == item.previous->size)
+    {
+        item.state = EXTRACT_TOUCHED;
+        return;
+    }
+    item.image = bytes.empty() ? cv::Mat() : cv::imdecode(bytes, flags);
+}
 
+/**
+ * @brief Copy the row of an image from the CSV file of the last run.
+ *
+ * @param fd The CSV file of the last run.
+ * @param entry The entry of the image in the last manifest.
+ * @param row A buffer for the row, reused from one image to the next.
+ * @param fp The new CSV file.
+ * @return 0 if successful, -1 if error.
+ */
+static int copyRow(int fd, const ManifestEntry &entry, std::vector<char> &row, FILE *fp)
+{
+    row.resize(entry.rowLength);
+    if (fd < 0 || pread(fd, &row[0], row.size(), (off_t)entry.rowOffset) != (ssize_t)row.size())
+    {
+        return -1;
+    }
+    return fwrite(&row[0], 1, row.size(), fp) == row.size() ? 0 : -1;
+}
+
+/**
+ * @brief Compute the feature vector of a decoded image.
+ *
+ * @param featureType 0 for the 7x7 center patch, 1 for the color palette.
+ * @param image The decoded image, greyscale for the patch and color for the palette.
+ * @param featureVector Receives the feature vector.
+ * @return 0 if successful, -1 if error.
+ */
+static int computeFeature(int featureType, const cv::Mat &image, std::vector<float> &featureVector)
+{
+    if (featureType == 1)
+    {
+        // the palette of the dominant colors, 4 values per color
+        PaletteFeature palette;
+        if (extractPaletteFeature(image, palette) != 0)
+        {
+            return -1;
+        }
+        paletteToVector(palette, featureVector);
+        return 0;
+    }
+
+    // the patch does not fit in images smaller than 7x7
+    try
+    {
+        featureVector = extractFeatureVector(image);
+    }
+    catch (const cv::Exception &)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Print the number of images through each stage and the throughput so far.
+ */
+static void printProgress(const ExtractProgress &progress, double seconds, bool done)
+{
+    int written = progress.written.images;
+    printf("\rlisted %d  decoded %d  extracted %d  written %d  failed %d  %.1f images/s%s", (int)progress.listed.images,
+           (int)progress.decoded.images, (int)progress.extracted.images, written, (int)progress.failed,
+           seconds > 0 ? written / seconds : 0.0, done ? "\n" : "");
+    fflush(stdout);
+}
+
+/**
+ * @brief Print the throughput one stage would reach on its own, the images per second of its busy time times its
+ * threads. The pipeline runs at the speed of the slowest stage.
+ */
+static void printStage(const char *name, const StageCounter &counter)
+{
+    double busy = counter.busyNanoseconds * 1e-9;
+    int images = counter.images;
+    printf("%-8s %2d threads  %8d images  %8.3f ms per image  %9.1f images/s\n", name, counter.threads, images,
+           images > 0 ? 1000 * busy / images : 0.0, busy > 0 ? images * counter.threads / busy : 0.0);
+}
+
+/**
+ * @brief Main function to extract the feature vectors of a directory of images
+ *
+ * The main thread lists the directory, decoder threads read and decode the files, extractor threads compute the
+ * feature vectors and a single writer thread appends the rows to the CSV file in the order of the listing, so the file
+ * is the same for any number of threads. Every queue between two stages is bounded, so a slow stage holds back the
+ * stages before it instead of filling the memory.
+ *
+ * The manifest of the last run records the size, modification time and content hash of every image. Images with the
+ * same size and modification time go straight to the writer, which copies their row from the last CSV file. Images
+ * whose content hash did not change are not decoded. Images of the manifest that are gone are kept as deleted, and the
+ * new CSV file and manifest replace the old ones once they are complete. The manifest also records the image
+ * directory, and a run on a different directory extracts every image.
+ *
+ * @param argc The number of command line arguments
+ * @param argv The command line arguments
+ * @return int The exit status
+ */
 int main(int argc, char *argv[])
 {
-    if (argc < 1)
+    int threads = (int)std::thread::hardware_concurrency();
+    bool full = false;
+    std::vector<char *> args;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--full") == 0)
+        {
+            full = true;
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.empty())
     {
-        printf("Usage: ./feature_extract %s <image_directory>\n", argv[0]);
+        printf("Usage: %s <image_directory> [featureType] [--threads N] [--full]\n", argv[0]);
+        printf("Feature type: \n0 for the 7x7 center patch (default) \n1 for the %d color palette\n", PALETTE_COLORS);
+        printf("--full extracts every image instead of only the images changed since the last run\n");
         exit(-1);
     }
+    std::string dirPath = args[0];
+    int featureType = args.size() > 1 ? atoi(args[1]) : 0;
+    threads = std::max(threads, 1);
 
-    printf("\n\n========== Feature Extract ==========\n\n");
+    // Decoding costs about as much as the patch and less than the palette, so give it a quarter of the threads
+    const int extractors = threads;
+    const int decoders = std::max(1, threads / 4);
 
-    char dirPath[256];
-    char buffer[256];
-    DIR *dirp;
-    struct dirent *dp;
+    // Images are processed one per thread, so keep OpenCV and kmeans from starting threads of their own
+    cv::setNumThreads(1);
 
-    strcpy(dirPath, argv[1]);
-    printf("Image directory set to %s\n", dirPath);
-    dirp = opendir(dirPath);
+    printf("\n\n========== Feature Extract ==========\n\n");
+
+    printf("Image directory set to %s\n", dirPath.c_str());
+    DIR *dirp = opendir(dirPath.c_str());
     if (dirp == NULL)
     {
-        printf("Cannot open directory %s\n", dirPath);
+        printf("Cannot open directory %s\n", dirPath.c_str());
         exit(-1);
     }
 
-    printf("Creating feature_vectors directory...\n\n\n");
+    printf("Creating feature_vectors directory...\n");
     std::string feature_vectors_dir = "feature_vectors";
-    // Create a .csv file
-    std::string feature_vectors_csv = feature_vectors_dir + "/feature_vectors.csv";
-    FILE *fp = fopen(feature_vectors_csv.c_str(), "w");
+    if (mkdir(feature_vectors_dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        printf("Cannot create directory %s\n", feature_vectors_dir.c_str());
+        closedir(dirp);
+        exit(-1);
+    }
+    std::string feature_vectors_csv =
+        feature_vectors_dir + (featureType == 1 ? "/palette_vectors.csv" : "/feature_vectors.csv");
+    std::string manifest_file = feature_vectors_csv + ".manifest";
+    printf("Feature vector file: %s\n", feature_vectors_csv.c_str());
+
+    // The last run, only the entries that still have their row in the CSV file can be kept. A full run keeps none but
+    // still carries the deleted images over. The CSV file does not depend on the image directory, so a manifest of
+    // another directory describes none of these images and is dropped entirely.
+    Manifest previous;
+    std::string directory = manifestDirectory(dirPath);
+    std::string previousDirectory;
+    if (readManifest(manifest_file, previous, previousDirectory) != 0)
+    {
+        closedir(dirp);
+        exit(-1);
+    }
+    if (!previous.empty() && previousDirectory != directory)
+    {
+        printf("The last run indexed %s, extracting every image\n",
+               previousDirectory.empty() ? "an unrecorded directory" : previousDirectory.c_str());
+        previous.clear();
+        full = true;
+    }
+    int rows = full ? 0 : indexFeatureRows(feature_vectors_csv, previous);
+    printf("Manifest: %lu images, %d rows kept from the last feature vector file\n", previous.size(), rows);
+    int previousFd = rows > 0 ? open(feature_vectors_csv.c_str(), O_RDONLY) : -1;
+
+    // Write the new file beside the old one, the old rows are copied from it
+    std::string temporary_csv = feature_vectors_csv + ".tmp";
+    FILE *fp = fopen(temporary_csv.c_str(), "w");
+    if (fp == NULL)
+    {
+        printf("Unable to open output file %s\n", temporary_csv.c_str());
+        closedir(dirp);
+        exit(-1);
+    }
+    printf("Threads: %d decoders, %d extractors, 1 writer\n\n", decoders, extractors);
+
+    // Capacities bound the number of decoded images in flight
+    BoundedQueue<ExtractItem> paths(1024);
+    BoundedQueue<ExtractItem> decoded(2 * extractors);
+    BoundedQueue<ExtractItem> extracted(2 * extractors);
+
+    // One token per image between the listing and the writer. The listing waits for a free token, so the writer never
+    // holds back more than EXTRACT_WINDOW rows while an early image is slow.
+    BoundedQueue<int> window(EXTRACT_WINDOW);
 
-    // loop over all the files in the image file listing
+    ExtractProgress progress;
+    initCounter(progress.listed, 1);
+    initCounter(progress.decoded, decoders);
+    initCounter(progress.extracted, extractors);
+    initCounter(progress.written, 1);
+    progress.failed = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        progress.states[i] = 0;
+    }
+    progress.finished = false;
+
+    const int flags = featureType == 1 ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE;
+    std::vector<std::thread> decoderThreads, extractorThreads;
+
+    for (int i = 0; i < decoders; i++)
+    {
+        decoderThreads.push_back(std::thread([&] {
+            std::vector<uchar> bytes;
+            ExtractItem item;
+            while (paths.pop(item))
+            {
+                {
+                    StageTimer timer(progress.decoded);
+                    decodeImage(dirPath + "/" + item.name, flags, bytes, item);
+                }
+                // Failed images still go down the pipeline so the writer can move past them
+                if (item.reused())
+                {
+                    progress.decoded.images++;
+                }
+                else if (item.image.empty())
+                {
+                    printf("\nNo image data: %s\n", item.name.c_str());
+                    item.failed = true;
+                }
+                else
+                {
+                    progress.decoded.images++;
+                }
+                decoded.push(item);
+            }
+        }));
+    }
 
-    while ((dp = readdir(dirp)) != NULL)
+    for (int i = 0; i < extractors; i++)
     {
-        if (strstr(dp->d_name, ".jpg") || strstr(dp->d_name, ".png") || strstr(dp->d_name, ".ppm") ||
-            strstr(dp->d_name, ".tif"))
+        extractorThreads.push_back(std::thread([&] {
+            ExtractItem item;
+            while (decoded.pop(item))
+            {
+                if (!item.failed && !item.reused())
+                {
+                    StageTimer timer(progress.extracted);
+                    if (computeFeature(featureType, item.image, item.featureVector) != 0)
+                    {
+                        printf("\nSkipping %s\n", item.name.c_str());
+                        item.failed = true;
+                    }
+                    else
+                    {
+                        progress.extracted.images++;
+                    }
+                }
+                item.image.release();
+                extracted.push(item);
+            }
+        }));
+    }
+
+    // The manifest of this run, filled by the writer
+    Manifest current;
+    current.reserve(previous.size());
+
+    std::thread writer([&] {
+        // Rows that arrived before an earlier image, by listing position
+        std::map<long, ExtractItem> pending;
+        long next = 0;
+        int token;
+        std::vector<char> row;
+
+        ExtractItem item;
+        while (extracted.pop(item))
+        {
+            long index = item.index;
+            pending[index] = std::move(item);
+
+            std::map<long, ExtractItem>::iterator it;
+            while ((it = pending.find(next)) != pending.end())
+            {
+                ExtractItem &done = it->second;
+                if (done.failed)
+                {
+                    progress.failed++;
+                }
+                else
+                {
+                    StageTimer timer(progress.written);
+                    int status = done.reused() ? copyRow(previousFd, *done.previous, row, fp)
+                                               : write_image_data_row(fp, done.name.c_str(), done.featureVector);
+                    if (status != 0)
+                    {
+                        printf("\nCannot write %s\n", done.name.c_str());
+                        done.failed = true;
+                        progress.failed++;
+                    }
+                    else
+                    {
+                        progress.states[done.state]++;
+                        progress.written.images++;
+                    }
+                }
+
+                // Images without a row are in the manifest too, but are extracted again on the next run
+                if (done.failed)
+                {
+                    done.entry.hash = 0;
+                }
+                current[done.name] = done.entry;
+                pending.erase(it);
+                next++;
+                window.pop(token);
+            }
+        }
+    });
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread reporter([&] {
+        // Wake up often so the report does not hold up the exit, print once a second
+        for (int ticks = 1; !progress.finished; ticks++)
         {
-            printf("processing image file: %s\n", dp->d_name);
-            strcpy(buffer, dirPath);
-            strcat(buffer, "/");
-            strcat(buffer, dp->d_name);
-            // printf("full path name: %s\n", buffer);
-
-            std::vector<float> featureVector = extractFeatureVector(buffer);
-            append_image_data_csv(feature_vectors_csv.c_str(), dp->d_name, featureVector, 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (ticks % 10 == 0)
+            {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printProgress(progress, seconds, false);
+            }
         }
+    });
+
+    // List the directory. push() blocks once the decoders fall 1024 files behind or the writer EXTRACT_WINDOW.
+    struct dirent *dp;
+    long index = 0;
+    while (true)
+    {
+        ExtractItem item;
+        {
+            StageTimer timer(progress.listed);
+            dp = readdir(dirp);
+            if (dp == NULL)
+            {
+                break;
+            }
+            if (!isImageFile(dp->d_name))
+            {
+                continue;
+            }
+            item.index = index++;
+            item.name = dp->d_name;
+
+            if (statManifestEntry(dirPath + "/" + item.name, item.entry) != 0)
+            {
+                item.failed = true;
+            }
+            Manifest::const_iterator it = previous.find(item.name);
+            if (it != previous.end() && !it->second.deleted && it->second.rowOffset >= 0)
+            {
+                item.previous = &it->second;
+                item.state = EXTRACT_CHANGED;
+                if (!item.failed && item.entry.size == item.previous->size && item.entry.mtime == item.previous->mtime)
+                {
+                    item.state = EXTRACT_UNCHANGED;
+                    item.entry.hash = item.previous->hash;
+                }
+            }
+        }
+        progress.listed.images++;
+
+        int token = 0;
+        window.push(token);
+        // Unchanged and missing images go straight to the writer
+        if (item.failed || item.state == EXTRACT_UNCHANGED)
+        {
+            extracted.push(item);
+        }
+        else
+        {
+            paths.push(item);
+        }
+    }
+    closedir(dirp);
+
+    // Shut the pipeline down one stage at a time so every listed image is written
+    paths.close();
+    for (size_t i = 0; i < decoderThreads.size(); i++)
+    {
+        decoderThreads[i].join();
+    }
+    decoded.close();
+    for (size_t i = 0; i < extractorThreads.size(); i++)
+    {
+        extractorThreads[i].join();
     }
+    extracted.close();
+    writer.join();
+    progress.finished = true;
+    reporter.join();
+
+    // The images of the last run that are gone stay in the manifest as deleted
+    int deleted = 0;
+    for (Manifest::iterator it = previous.begin(); it != previous.end(); ++it)
+    {
+        if (current.find(it->first) == current.end())
+        {
+            deleted += it->second.deleted ? 0 : 1;
+            it->second.deleted = true;
+            current[it->first] = it->second;
+        }
+    }
+
+    if (previousFd >= 0)
+    {
+        close(previousFd);
+    }
+    bool failed = ferror(fp) != 0;
+    if (fclose(fp) != 0 || failed || rename(temporary_csv.c_str(), feature_vectors_csv.c_str()) != 0)
+    {
+        printf("Unable to write output file %s\n", feature_vectors_csv.c_str());
+        remove(temporary_csv.c_str());
+        exit(-1);
+    }
+    if (writeManifest(manifest_file, current, directory) != 0)
+    {
+        exit(-1);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printProgress(progress, seconds, true);
 
     printf("\n=====================================\n\n");
+    printf("Stage throughput:\n");
+    printStage("list", progress.listed);
+    printStage("decode", progress.decoded);
+    printStage("extract", progress.extracted);
+    printStage("write", progress.written);
+    printf("\n%d new, %d changed, %d touched, %d unchanged, %d deleted, %d failed\n", (int)progress.states[EXTRACT_NEW],
+           (int)progress.states[EXTRACT_CHANGED], (int)progress.states[EXTRACT_TOUCHED],
+           (int)progress.states[EXTRACT_UNCHANGED], deleted, (int)progress.failed);
+    printf("Wrote %d images in %.2f s (%.1f images/s)\n", (int)progress.written.images, seconds,
+           seconds > 0 ? progress.written.images / seconds : 0.0);
     printf("Completed feature extraction\n");
     printf("Terminating\n\n");
 
-    return 0;
-}
\ No newline at end of file
+    return progress.failed > 0 ? 1 : 0;
+}
@@ -24,6 +24,17 @@ std::vector<float> extractFeatureVector(const std::string &imagePath)
         throw std::runtime_error("Could not read image: " + imagePath);
     }
 
+    return extractFeatureVector(image);
+}
+
+/**
+ * @brief Extract a feature vector from an image already in memory
+ *
+ * @param image The greyscale image, at least 7x7
+ * @return std::vector<float> The feature vector
+ */
+std::vector<float> extractFeatureVector(const cv::Mat &image)
+{
     int centerX = image.cols / 2;
     int centerY = image.rows / 2;
 
@@ -29,6 +29,14 @@ struct ImageMatch
  */
 std::vector<float> extractFeatureVector(const std::string &imagePath);
 
+/**
+ * @brief Extract a feature vector from an image already in memory
+ *
+ * @param image The greyscale image, at least 7x7
+ * @return std::vector<float> The feature vector
+ */
+std::vector<float> extractFeatureVector(const cv::Mat &image);
+
 /**
  * @brief Compute the Euclidean distance between two feature vectors
  *
@@ -2,10 +2,14 @@
 // Date: January 9, 2024
 // Purpose: Display live video using OpenCV.
 
+#include <cstring>
 #include <opencv2/core.hpp>
 #include <opencv2/opencv.hpp>
 
+#include "bilateral.h"
 #include "filter.h"
+#include "frame_pool.h"
+#include "separable_kernel.h"
 
 /**
  * @brief Convert a color image to greyscale.
@@ -225,10 +229,9 @@ int blur5x5_2(cv::Mat &src, cv::Mat &dst)
 /**
  * @brief Blur a color image using a 5x5 Gaussian kernel.
  *
- * This function blurs a color image using a 5x5 Gaussian kernel. It does so by
- * applying the kernel to each pixel within a nested loop. This version of the function
- * uses the .at method to access the pixels. It adds the values of each pixel in the kernel
- * without looping through it.
+ * This function blurs a color image using the 5x5 Gaussian kernel from blur5x5_1. The kernel is the outer product of
+ * the [1 2 4 2 1] taps with themselves, so it is applied by the Gauss5x5Kernel template as a vertical and a horizontal
+ * pass that are unrolled at compile time. The two pixel border is copied from src.
  *
  * @param src The source image.
  * @param dst The destination image.
@@ -236,170 +239,47 @@ int blur5x5_2(cv::Mat &src, cv::Mat &dst)
  */
 int blur5x5_3(cv::Mat &src, cv::Mat &dst)
 {
-    if (src.empty())
-    {
-        printf("Frame is empty\n");
-        return -1;
-    }
-
-    // int kernel[5][5] = {// Gaussian kernel 5x5
-    //                     {1, 2, 4, 2, 1},
-    //                     {2, 4, 8, 4, 2},
-    //                     {4, 8, 16, 8, 4},
-    //                     {2, 4, 8, 4, 2},
-    //                     {1, 2, 4, 2, 1}};
-    // int kernelSum = 100; // sum of all kernel values
-
-    dst = src.clone();
-
-    for (int y = 2; y < src.rows - 2; y++)
-    {
-        // cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
-        for (int x = 2; x < src.cols - 2; x++)
-        {
-            for (int k = 0; k < src.channels(); k++)
-            {
-                int sum = src.at<cv::Vec3b>(y - 2, x - 2)[k] + 2 * src.at<cv::Vec3b>(y - 2, x - 1)[k] +
-                          4 * src.at<cv::Vec3b>(y - 2, x)[k] + 2 * src.at<cv::Vec3b>(y - 2, x + 1)[k] +
-                          src.at<cv::Vec3b>(y - 2, x + 2)[k] + 2 * src.at<cv::Vec3b>(y - 1, x - 2)[k] +
-                          4 * src.at<cv::Vec3b>(y - 1, x - 1)[k] + 8 * src.at<cv::Vec3b>(y - 1, x)[k] +
-                          4 * src.at<cv::Vec3b>(y - 1, x + 1)[k] + 2 * src.at<cv::Vec3b>(y - 1, x + 2)[k] +
-                          4 * src.at<cv::Vec3b>(y, x - 2)[k] + 8 * src.at<cv::Vec3b>(y, x - 1)[k] +
-                          16 * src.at<cv::Vec3b>(y, x)[k] + 8 * src.at<cv::Vec3b>(y, x + 1)[k] +
-                          4 * src.at<cv::Vec3b>(y, x + 2)[k] + 2 * src.at<cv::Vec3b>(y + 1, x - 2)[k] +
-                          4 * src.at<cv::Vec3b>(y + 1, x - 1)[k] + 8 * src.at<cv::Vec3b>(y + 1, x)[k] +
-                          4 * src.at<cv::Vec3b>(y + 1, x + 1)[k] + 2 * src.at<cv::Vec3b>(y + 1, x + 2)[k] +
-                          src.at<cv::Vec3b>(y + 2, x - 2)[k] + 2 * src.at<cv::Vec3b>(y + 2, x - 1)[k] +
-                          4 * src.at<cv::Vec3b>(y + 2, x)[k] + 2 * src.at<cv::Vec3b>(y + 2, x + 1)[k];
-
-                sum /= 100;
-
-                dst.at<cv::Vec3b>(y, x)[k] = sum;
-            }
-        }
-    }
-
-    return 0;
+    return separableFilter<Gauss5x5Kernel>(src, dst);
 }
 
 /**
- * @brief Blur a color image using a 5x5 Gaussian kernel.
- *
- * This function blurs a color image using a 5x5 Gaussian kernel. It does so by
- * applying the kernel to each pixel within a nested loop. This version of the function uses the .ptr method to access
- * pixels. It also does not loop through the kernel, but instead calculates the sum of each row and column of the kernel
- * separately.
+ * @brief Alias of blur5x5_3, kept as its own entry point for existing callers.
  *
  * @param src The source image.
  * @param dst The destination image.
  * @return 0 if successful, -1 if error.
- **/
+ */
 int blur5x5_4(cv::Mat &src, cv::Mat &dst)
 {
-    src.copyTo(dst);
-
-    // int kernel[5][5] = {// Gaussian kernel 5x5
-    //                     {1, 2, 4, 2, 1},
-    //                     {2, 4, 8, 4, 2},
-    //                     {4, 8, 16, 8, 4},
-    //                     {2, 4, 8, 4, 2},
-    //                     {1, 2, 4, 2, 1}};
-    // int kernelSum = 100; // sum of all kernel values
-
-    for (int y = 2; y < src.rows - 2; y++)
-    {
-        // This .ptr method is faster than .at method because it stores the row as reference.
-        cv::Vec3b *ptrTwoUp = src.ptr<cv::Vec3b>(y - 2);
-        cv::Vec3b *ptrOneUp = src.ptr<cv::Vec3b>(y - 1);
-        cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
-        cv::Vec3b *ptrOneDown = src.ptr<cv::Vec3b>(y + 1);
-        cv::Vec3b *ptrTwoDown = src.ptr<cv::Vec3b>(y + 2);
-
-        cv::Vec3b *ptrDst = dst.ptr<cv::Vec3b>(y);
-
-        for (int x = 2; x < src.cols - 2; x++)
-        {
-
-            for (int k = 0; k < src.channels(); k++)
-            {
-                // ptrmd[x][k] accesses the pixel at (x, y) and color channel k
-                int sumOne = ptrTwoUp[x - 2][k] + 2 * ptrTwoUp[x - 1][k] + 4 * ptrTwoUp[x][k] + 2 * ptrTwoUp[x + 1][k] +
-                             ptrTwoUp[x + 2][k];
-                int sumTwo = 2 * ptrOneUp[x - 2][k] + 4 * ptrOneUp[x - 1][k] + 8 * ptrOneUp[x][k] +
-                             4 * ptrOneUp[x + 1][k] + 2 * ptrOneUp[x + 2][k];
-                int sumThree =
-                    4 * ptr[x - 2][k] + 8 * ptr[x - 1][k] + 16 * ptr[x][k] + 8 * ptr[x + 1][k] + 4 * ptr[x + 2][k];
-                int sumFour = 2 * ptrOneDown[x - 2][k] + 4 * ptrOneDown[x - 1][k] + 8 * ptrOneDown[x][k] +
-                              4 * ptrOneDown[x + 1][k] + 2 * ptrOneDown[x + 2][k];
-                int sumFive = ptrTwoDown[x - 2][k] + 2 * ptrTwoDown[x - 1][k] + 4 * ptrTwoDown[x][k] +
-                              2 * ptrTwoDown[x + 1][k] + ptrTwoDown[x + 2][k];
-
-                int sum = sumOne + sumTwo + sumThree + sumFour + sumFive;
-
-                sum /= 100;
-
-                ptrDst[x][k] = sum; // assign result
-            }
-        }
-    }
+    return blur5x5_3(src, dst);
+}
 
-    return 0;
+/**
+ * @brief Alias of blur5x5_3, kept as its own entry point for existing callers.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int blur5x5_5(cv::Mat &src, cv::Mat &dst)
+{
+    return blur5x5_3(src, dst);
 }
 
 /**
  * @brief Blur a color image using a 1x5 Gaussian kernel.
  *
- * This function blurs a color image using a 1x5 Gaussian kernel. It does so by
- * applying separable 1x5 filters to each pixel in two passes (horizontal and veritcal). This version of the function
- * uses the .ptr method to access pixels. It also does not loop through the kernel, but instead calculates the sum of
- * each row and column of the kernel separately.
+ * Same result as blur5x5_4, but the image is processed in column strips sized to the detected cache sizes. Within a
+ * strip each row runs the vertical pass over the five source row segments into a strip wide buffer, then the
+ * horizontal pass over that buffer, so the row segments are reused from cache by the next four rows of the strip.
  *
  * @param src The source image.
  * @param dst The destination image.
  * @return 0 if successful, -1 if error.
  */
-int blur5x5_5(cv::Mat &src, cv::Mat &dst)
+int blur5x5_7(cv::Mat &src, cv::Mat &dst)
 {
-    src.copyTo(dst);
-
-    int kernel[5] = {1, 2, 4, 2, 1};
-    int kernelSum = 10;
-
-    // Horizontal pass
-    for (int y = 0; y < src.rows; y++)
-    {
-        cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
-        for (int x = 2; x < src.cols - 2; x++)
-        {
-            for (int k = 0; k < src.channels(); k++)
-            {
-                int sum = ptr[x - 2][k] + 2 * ptr[x - 1][k] + 4 * ptr[x][k] + 2 * ptr[x + 1][k] + ptr[x + 2][k];
-
-                sum /= 10;
-
-                dst.ptr<cv::Vec3b>(y)[x][k] = sum;
-            }
-        }
-    }
-
-    // Vertical pass
-    for (int y = 2; y < src.rows - 2; y++)
-    {
-        cv::Vec3b *ptr = dst.ptr<cv::Vec3b>(y);
-        for (int x = 0; x < src.cols; x++)
-        {
-            for (int k = 0; k < src.channels(); k++)
-            {
-                int sum = ptr[x - 2][k] + 2 * ptr[x - 1][k] + 4 * ptr[x][k] + 2 * ptr[x + 1][k] + ptr[x + 2][k];
-
-                sum /= 10;
-
-                dst.ptr<cv::Vec3b>(y)[x][k] = sum;
-            }
-        }
-    }
-
-    return 0;
+    return separableFilterTiled<Gauss5x5Kernel>(src, dst);
 }
 
 /**
@@ -413,34 +293,25 @@ int blur5x5_5(cv::Mat &src, cv::Mat &dst)
  */
 int gauss3x3at(cv::Mat &src, cv::Mat &dst) // pass images by reference
 {
-    // allocate space for destination image
-    src.copyTo(dst); // Let's us ignore the outer boundaries
-
-    // alternative
-    // dst.create(src.size(), src.type()); // makes duplicate image, uninitialized data
-
-    // only calculating values for pixels where filter fits in the image.
-    for (int y = 1; y < src.rows - 1; y++) // rows
-    {
-        for (int x = 1; x < src.cols - 1; x++) // cols
-        {
-            for (int k = 0; k < src.channels(); k++) // color channels
-            {
-                int sum = src.at<cv::Vec3b>(y - 1, x - 1)[k] + 2 * src.at<cv::Vec3b>(y - 1, x)[k] +
-                          src.at<cv::Vec3b>(y - 1, x + 1)[k] + 2 * src.at<cv::Vec3b>(y, x - 1)[k] +
-                          4 * src.at<cv::Vec3b>(y, x)[k] + 2 * src.at<cv::Vec3b>(y, x + 1)[k] +
-                          src.at<cv::Vec3b>(y + 1, x - 1)[k] + 2 * src.at<cv::Vec3b>(y + 1, x)[k] +
-                          src.at<cv::Vec3b>(y + 1, x + 1)[k];
-
-                // normalize the value back to a range of [0 ,255]
-                sum /= 16;
-
-                dst.at<cv::Vec3b>(y, x)[k] = sum;
-            }
-        }
-    }
+    //  1  2  1
+    //  2  4  2
+    //  1  2  1
+    // normalized by 16, outer boundaries are copied from src
+    return separableFilter<Gauss3x3Kernel>(src, dst);
+}
 
-    return 0;
+/**
+ * @brief Blur a color image using a 7x7 Gaussian kernel.
+ *
+ * This function blurs a color image using the [1 6 15 20 15 6 1] binomial kernel in both directions.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int blur7x7(cv::Mat &src, cv::Mat &dst)
+{
+    return separableFilter<Gauss7x7Kernel>(src, dst);
 }
 
 /**
@@ -458,31 +329,7 @@ int sobelX3x3(cv::Mat &src, cv::Mat &dst)
     // -1  0  1
     // -2  0  2
     // -1  0  1
-    if (src.empty())
-    {
-        printf("Frame is empty\n");
-        return -1;
-    }
-
-    dst.create(src.size(), CV_16SC3); // Create dst with signed short type
-
-    for (int y = 1; y < src.rows - 1; y++)
-    {
-        cv::Vec3b *ptrUp = src.ptr<cv::Vec3b>(y - 1);
-        cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
-        cv::Vec3b *ptrDown = src.ptr<cv::Vec3b>(y + 1);
-        for (int x = 1; x < src.cols - 1; x++)
-        {
-            for (int k = 0; k < src.channels(); k++)
-            {
-                int sum = -ptrUp[x - 1][k] - 2 * ptr[x - 1][k] - ptrDown[x - 1][k] + ptrUp[x + 1][k] +
-                          2 * ptr[x + 1][k] + ptrDown[x + 1][k];
-
-                dst.ptr<cv::Vec3s>(y)[x][k] = static_cast<short>(sum);
-            }
-        }
-    }
-    return 0;
+    return separableFilter<SobelX3x3Kernel>(src, dst);
 }
 
 /**
@@ -500,34 +347,70 @@ int sobelY3x3(cv::Mat &src, cv::Mat &dst)
     // -1 -2 -1
     //  0  0  0
     //  1  2  1
+    return separableFilter<SobelY3x3Kernel>(src, dst);
+}
 
-    if (src.empty())
-    {
-        printf("Frame is empty\n");
-        return -1;
-    }
-
-    dst.create(src.size(), CV_16SC3); // Create dst with signed short type
+/**
+ * @brief Enhance vertical lines in an image using a 3x3 Scharr kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int scharrX3x3(cv::Mat &src, cv::Mat &dst)
+{
+    //  -3  0  3
+    // -10  0 10
+    //  -3  0  3
+    return separableFilter<ScharrX3x3Kernel>(src, dst);
+}
 
-    for (int y = 1; y < src.rows - 1; y++)
-    {
-        cv::Vec3b *ptrUp = src.ptr<cv::Vec3b>(y - 1);
-        cv::Vec3b *ptrDown = src.ptr<cv::Vec3b>(y + 1);
+/**
+ * @brief Enhance horizontal lines in an image using a 3x3 Scharr kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int scharrY3x3(cv::Mat &src, cv::Mat &dst)
+{
+    // -3 -10 -3
+    //  0   0  0
+    //  3  10  3
+    return separableFilter<ScharrY3x3Kernel>(src, dst);
+}
 
-        for (int x = 1; x < src.cols - 1; x++)
-        {
-            for (int k = 0; k < src.channels(); k++)
-            {
-                int sum = -ptrUp[x - 1][k] - 2 * ptrUp[x][k] - ptrUp[x + 1][k] + ptrDown[x - 1][k] + 2 * ptrDown[x][k] +
-                          ptrDown[x + 1][k];
+/**
+ * @brief Enhance vertical lines in an image using a 3x3 Prewitt kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int prewittX3x3(cv::Mat &src, cv::Mat &dst)
+{
+    // -1  0  1
+    // -1  0  1
+    // -1  0  1
+    return separableFilter<PrewittX3x3Kernel>(src, dst);
+}
 
-                dst.ptr<cv::Vec3s>(y)[x][k] = static_cast<short>(sum);
-            }
-        }
-    }
-    return 0;
+/**
+ * @brief Enhance horizontal lines in an image using a 3x3 Prewitt kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int prewittY3x3(cv::Mat &src, cv::Mat &dst)
+{
+    // -1 -1 -1
+    //  0  0  0
+    //  1  1  1
+    return separableFilter<PrewittY3x3Kernel>(src, dst);
 }
 
+
 /**
  * @brief Calculate the gradient magnitude of an image.
  *
@@ -611,7 +494,16 @@ int blurQuantize(cv::Mat &src, cv::Mat &dst, int levels)
         return -1;
     }
 
-    blur5x5_5(src, dst);
+    if (levels < 1)
+    {
+        printf("Invalid number of levels: %d\n", levels);
+        return -1;
+    }
+
+    if (blur5x5_5(src, dst) != 0)
+    {
+        return -1;
+    }
 
     float buckets = 255.0 / levels;
 
@@ -622,9 +514,8 @@ int blurQuantize(cv::Mat &src, cv::Mat &dst, int levels)
         {
             for (int k = 0; k < dst.channels(); k++)
             {
-                uchar pixel = ptr[x][k];
-                int quantized = static_cast<int>(pixel / buckets);
-                pixel = static_cast<uchar>(quantized * buckets);
+                int quantized = static_cast<int>(ptr[x][k] / buckets);
+                ptr[x][k] = static_cast<uchar>(quantized * buckets);
             }
         }
     }
@@ -632,6 +523,58 @@ int blurQuantize(cv::Mat &src, cv::Mat &dst, int levels)
     return 0;
 }
 
+/**
+ * @brief Smooth a color image with an edge preserving bilateral grid and quantize it to a specified number of levels.
+ *
+ * Cartoon version of blurQuantize. The bilateral grid flattens regions without smearing the edges between them, and
+ * each channel is then quantized into the given number of levels.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @param levels The number of levels to quantize the image to.
+ * @return 0 if successful, -1 if error.
+ */
+int bilateralQuantize(cv::Mat &src, cv::Mat &dst, int levels)
+{
+    if (src.empty())
+    {
+        printf("Frame is empty\n");
+        return -1;
+    }
+
+    if (levels < 1)
+    {
+        printf("Invalid number of levels: %d\n", levels);
+        return -1;
+    }
+
+    // 16 pixel cells and 24 intensity levels keep small details while flattening larger regions
+    if (bilateralGrid(src, dst, 16.0f, 24.0f) != 0)
+    {
+        return -1;
+    }
+
+    float buckets = 255.0 / levels;
+
+    // Every channel value maps to the same bucket, so build the table once
+    uchar table[256];
+    for (int i = 0; i < 256; i++)
+    {
+        table[i] = static_cast<uchar>(static_cast<int>(i / buckets) * buckets);
+    }
+
+    for (int y = 0; y < dst.rows; y++)
+    {
+        uchar *ptr = dst.ptr<uchar>(y);
+        for (int x = 0; x < dst.cols * 3; x++)
+        {
+            ptr[x] = table[ptr[x]];
+        }
+    }
+
+    return 0;
+}
+
 /**
  * @brief Apply an emboss effect to an image.
  *
@@ -743,3 +686,406 @@ int negativeFilter(cv::Mat &src, cv::Mat &dst)
 
     return 0;
 }
+
+
+// ==================== Allocation-free variants ====================
+
+/**
+ * @brief Check that a caller-owned output image has the expected size and type.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @param type The expected type of dst.
+ * @return true if src is not empty and dst matches, false otherwise.
+ */
+static bool checkOutput(const cv::Mat &src, const cv::Mat &dst, int type)
+{
+    if (src.empty())
+    {
+        printf("Frame is empty\n");
+        return false;
+    }
+
+    if (src.type() != CV_8UC3 || dst.rows != src.rows || dst.cols != src.cols || dst.type() != type)
+    {
+        printf("Destination must be preallocated with the size of the source frame\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Convert a color image to greyscale into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @return 0 if successful, -1 if error.
+ */
+int greyscaleInto(const cv::Mat &src, cv::Mat &dst)
+{
+    if (!checkOutput(src, dst, CV_8UC3))
+    {
+        return -1;
+    }
+
+    for (int y = 0; y < src.rows; y++)
+    {
+        const cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
+        cv::Vec3b *ptrDst = dst.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < src.cols; x++)
+        {
+            uchar invertedRed = 255 - ptr[x][2];
+            ptrDst[x] = cv::Vec3b(invertedRed, invertedRed, invertedRed);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Convert a color image to sepia tone into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @return 0 if successful, -1 if error.
+ */
+int sepiaToneInto(const cv::Mat &src, cv::Mat &dst)
+{
+    if (!checkOutput(src, dst, CV_8UC3))
+    {
+        return -1;
+    }
+
+    for (int y = 0; y < src.rows; y++)
+    {
+        const cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
+        cv::Vec3b *ptrDst = dst.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < src.cols; x++)
+        {
+            uchar blue = ptr[x][0];
+            uchar green = ptr[x][1];
+            uchar red = ptr[x][2];
+
+            uchar newRed = std::min(255.0, 0.393 * red + 0.769 * green + 0.189 * blue);
+            uchar newGreen = std::min(255.0, 0.349 * red + 0.686 * green + 0.168 * blue);
+            uchar newBlue = std::min(255.0, 0.272 * red + 0.534 * green + 0.131 * blue);
+
+            ptrDst[x] = cv::Vec3b(newBlue, newGreen, newRed);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Blur a color image using separable 1x5 Gaussian kernels into a preallocated image.
+ *
+ * Produces the same result as blur5x5_2. The horizontal pass buffer is taken from the pool.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @param pool The pool to take the temporary buffer from.
+ * @return 0 if successful, -1 if error.
+ */
+int blur5x5_2Into(const cv::Mat &src, cv::Mat &dst, FramePool &pool)
+{
+    if (!checkOutput(src, dst, CV_8UC3))
+    {
+        return -1;
+    }
+
+    PooledMat pooledTemp(pool, src.rows, src.cols, CV_8UC3);
+    cv::Mat &temp = pooledTemp.get();
+
+    // Horizontal pass. The two columns at each edge stay zero, as in blur5x5_2.
+    for (int y = 0; y < src.rows; y++)
+    {
+        const cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
+        cv::Vec3b *ptrTemp = temp.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < src.cols; x++)
+        {
+            if (x < 2 || x >= src.cols - 2)
+            {
+                ptrTemp[x] = cv::Vec3b(0, 0, 0);
+                continue;
+            }
+
+            for (int k = 0; k < 3; k++)
+            {
+                int sum = ptr[x - 2][k] + 2 * ptr[x - 1][k] + 4 * ptr[x][k] + 2 * ptr[x + 1][k] + ptr[x + 2][k];
+                ptrTemp[x][k] = sum / 10;
+            }
+        }
+    }
+
+    // Vertical pass. The two rows at each edge are copied from the source.
+    for (int y = 0; y < src.rows; y++)
+    {
+        cv::Vec3b *ptrDst = dst.ptr<cv::Vec3b>(y);
+
+        if (y < 2 || y >= src.rows - 2)
+        {
+            if (dst.data != src.data)
+            {
+                memcpy(ptrDst, src.ptr<cv::Vec3b>(y), src.cols * sizeof(cv::Vec3b));
+            }
+            continue;
+        }
+
+        const cv::Vec3b *ptrTwoUp = temp.ptr<cv::Vec3b>(y - 2);
+        const cv::Vec3b *ptrOneUp = temp.ptr<cv::Vec3b>(y - 1);
+        const cv::Vec3b *ptr = temp.ptr<cv::Vec3b>(y);
+        const cv::Vec3b *ptrOneDown = temp.ptr<cv::Vec3b>(y + 1);
+        const cv::Vec3b *ptrTwoDown = temp.ptr<cv::Vec3b>(y + 2);
+        for (int x = 0; x < src.cols; x++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int sum = ptrTwoUp[x][k] + 2 * ptrOneUp[x][k] + 4 * ptr[x][k] + 2 * ptrOneDown[x][k] + ptrTwoDown[x][k];
+                ptrDst[x][k] = sum / 10;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Set the one pixel border of a CV_16SC3 image to 0.
+ *
+ * @param dst The image.
+ */
+static void clearSobelBorder(cv::Mat &dst)
+{
+    for (int y = 0; y < dst.rows; y++)
+    {
+        cv::Vec3s *ptrDst = dst.ptr<cv::Vec3s>(y);
+        if (y == 0 || y == dst.rows - 1)
+        {
+            memset(ptrDst, 0, dst.cols * sizeof(cv::Vec3s));
+            continue;
+        }
+        ptrDst[0] = cv::Vec3s(0, 0, 0);
+        ptrDst[dst.cols - 1] = cv::Vec3s(0, 0, 0);
+    }
+}
+
+/**
+ * @brief Apply the 3x3 Sobel X kernel into a preallocated image. The one pixel border is set to 0.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_16SC3 with the size of src. Must not be src.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelX3x3Into(const cv::Mat &src, cv::Mat &dst)
+{
+    if (!checkOutput(src, dst, CV_16SC3))
+    {
+        return -1;
+    }
+
+    clearSobelBorder(dst);
+
+    for (int y = 1; y < src.rows - 1; y++)
+    {
+        const cv::Vec3b *ptrUp = src.ptr<cv::Vec3b>(y - 1);
+        const cv::Vec3b *ptr = src.ptr<cv::Vec3b>(y);
+        const cv::Vec3b *ptrDown = src.ptr<cv::Vec3b>(y + 1);
+        cv::Vec3s *ptrDst = dst.ptr<cv::Vec3s>(y);
+        for (int x = 1; x < src.cols - 1; x++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int sum = -ptrUp[x - 1][k] - 2 * ptr[x - 1][k] - ptrDown[x - 1][k] + ptrUp[x + 1][k] +
+                          2 * ptr[x + 1][k] + ptrDown[x + 1][k];
+                ptrDst[x][k] = static_cast<short>(sum);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Apply the 3x3 Sobel Y kernel into a preallocated image. The one pixel border is set to 0.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_16SC3 with the size of src. Must not be src.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelY3x3Into(const cv::Mat &src, cv::Mat &dst)
+{
+    if (!checkOutput(src, dst, CV_16SC3))
+    {
+        return -1;
+    }
+
+    clearSobelBorder(dst);
+
+    for (int y = 1; y < src.rows - 1; y++)
+    {
+        const cv::Vec3b *ptrUp = src.ptr<cv::Vec3b>(y - 1);
+        const cv::Vec3b *ptrDown = src.ptr<cv::Vec3b>(y + 1);
+        cv::Vec3s *ptrDst = dst.ptr<cv::Vec3s>(y);
+        for (int x = 1; x < src.cols - 1; x++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int sum = -ptrUp[x - 1][k] - 2 * ptrUp[x][k] - ptrUp[x + 1][k] + ptrDown[x - 1][k] + 2 * ptrDown[x][k] +
+                          ptrDown[x + 1][k];
+                ptrDst[x][k] = static_cast<short>(sum);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Calculate the gradient magnitude of an image into a preallocated image.
+ *
+ * The two Sobel images are taken from the pool.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @param pool The pool to take the temporary buffers from.
+ * @return 0 if successful, -1 if error.
+ */
+int magnitudeInto(const cv::Mat &src, cv::Mat &dst, FramePool &pool)
+{
+    if (!checkOutput(src, dst, CV_8UC3))
+    {
+        return -1;
+    }
+
+    PooledMat sobelX(pool, src.rows, src.cols, CV_16SC3);
+    PooledMat sobelY(pool, src.rows, src.cols, CV_16SC3);
+
+    sobelX3x3Into(src, sobelX.get());
+    sobelY3x3Into(src, sobelY.get());
+
+    for (int y = 0; y < dst.rows; y++)
+    {
+        const cv::Vec3s *ptrSx = sobelX.get().ptr<cv::Vec3s>(y);
+        const cv::Vec3s *ptrSy = sobelY.get().ptr<cv::Vec3s>(y);
+        cv::Vec3b *ptrDst = dst.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < dst.cols; x++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int sum = sqrt(ptrSx[x][k] * ptrSx[x][k] + ptrSy[x][k] * ptrSy[x][k]);
+                ptrDst[x][k] = sum;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Adjust the brightness of an image into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @param brightness The brightness value to multiply each pixel by.
+ * @return 0 if successful, -1 if error.
+ */
+int adjustBrightnessInto(const cv::Mat &src, cv::Mat &dst, double brightness)
+{
+    if (!checkOutput(src, dst, CV_8UC3))
+    {
+        return -1;
+    }
+
+    // Every pixel value maps to the same output, so build the table once
+    uchar table[256];
+    for (int i = 0; i < 256; i++)
+    {
+        table[i] = std::min(std::max(i * brightness, 0.0), 255.0);
+    }
+
+    for (int y = 0; y < src.rows; y++)
+    {
+        const uchar *ptr = src.ptr<uchar>(y);
+        uchar *ptrDst = dst.ptr<uchar>(y);
+        for (int x = 0; x < src.cols * 3; x++)
+        {
+            ptrDst[x] = table[ptr[x]];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Create a negative of an image into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @return 0 if successful, -1 if error.
+ */
+int negativeFilterInto(const cv::Mat &src, cv::Mat &dst)
+{
+    if (!checkOutput(src, dst, CV_8UC3))
+    {
+        return -1;
+    }
+
+    for (int y = 0; y < src.rows; y++)
+    {
+        const uchar *ptr = src.ptr<uchar>(y);
+        uchar *ptrDst = dst.ptr<uchar>(y);
+        for (int x = 0; x < src.cols * 3; x++)
+        {
+            ptrDst[x] = 255 - ptr[x];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Convert a color image to greyscale in place.
+ *
+ * @param img The image to modify.
+ * @return 0 if successful, -1 if error.
+ */
+int greyscaleInPlace(cv::Mat &img)
+{
+    return greyscaleInto(img, img);
+}
+
+/**
+ * @brief Convert a color image to sepia tone in place.
+ *
+ * @param img The image to modify.
+ * @return 0 if successful, -1 if error.
+ */
+int sepiaToneInPlace(cv::Mat &img)
+{
+    return sepiaToneInto(img, img);
+}
+
+/**
+ * @brief Adjust the brightness of an image in place.
+ *
+ * @param img The image to modify.
+ * @param brightness The brightness value to multiply each pixel by.
+ * @return 0 if successful, -1 if error.
+ */
+int adjustBrightnessInPlace(cv::Mat &img, double brightness)
+{
+    return adjustBrightnessInto(img, img, brightness);
+}
+
+/**
+ * @brief Create a negative of an image in place.
+ *
+ * @param img The image to modify.
+ * @return 0 if successful, -1 if error.
+ */
+int negativeFilterInPlace(cv::Mat &img)
+{
+    return negativeFilterInto(img, img);
+}
@@ -5,6 +5,8 @@
 #include <opencv2/core.hpp>
 #include <opencv2/opencv.hpp>
 
+#include "frame_pool.h"
+
 #ifndef FILTER_H
 #define FILTER_H
 
@@ -60,10 +62,9 @@ int blur5x5_2(cv::Mat &src, cv::Mat &dst);
 /**
  * @brief Blur a color image using a 5x5 Gaussian kernel.
  *
- * This function blurs a color image using a 5x5 Gaussian kernel. It does so by
- * applying the kernel to each pixel within a nested loop. This version of the function
- * uses the .at method to access the pixels. It adds the values of each pixel in the kernel
- * without looping through it.
+ * This function blurs a color image using the 5x5 Gaussian kernel from blur5x5_1. The kernel is the outer product of
+ * the [1 2 4 2 1] taps with themselves, so it is applied by the Gauss5x5Kernel template as a vertical and a horizontal
+ * pass that are unrolled at compile time. The two pixel border is copied from src.
  *
  * @param src The source image.
  * @param dst The destination image.
@@ -72,32 +73,35 @@ int blur5x5_2(cv::Mat &src, cv::Mat &dst);
 int blur5x5_3(cv::Mat &src, cv::Mat &dst);
 
 /**
- * @brief Blur a color image using a 5x5 Gaussian kernel.
- *
- * This function blurs a color image using a 5x5 Gaussian kernel. It does so by
- * applying the kernel to each pixel within a nested loop. This version of the function uses the .ptr method to access
- * pixels. It also does not loop through the kernel, but instead calculates the sum of each row and column of the kernel
- * separately.
+ * @brief Alias of blur5x5_3, kept as its own entry point for existing callers.
  *
  * @param src The source image.
  * @param dst The destination image.
  * @return 0 if successful, -1 if error.
- **/
+ */
 int blur5x5_4(cv::Mat &src, cv::Mat &dst);
 
+/**
+ * @brief Alias of blur5x5_3, kept as its own entry point for existing callers.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int blur5x5_5(cv::Mat &src, cv::Mat &dst);
+
 /**
  * @brief Blur a color image using a 1x5 Gaussian kernel.
  *
- * This function blurs a color image using a 1x5 Gaussian kernel. It does so by
- * applying separable 1x5 filters to each pixel in two passes (horizontal and veritcal). This version of the function
- * uses the .ptr method to access pixels. It also does not loop through the kernel, but instead calculates the sum of
- * each row and column of the kernel separately.
+ * Same result as blur5x5_4, but the image is processed in column strips sized to the detected cache sizes. Within a
+ * strip each row runs the vertical pass over the five source row segments into a strip wide buffer, then the
+ * horizontal pass over that buffer, so the row segments are reused from cache by the next four rows of the strip.
  *
  * @param src The source image.
  * @param dst The destination image.
  * @return 0 if successful, -1 if error.
  */
-int blur5x5_5(cv::Mat &src, cv::Mat &dst);
+int blur5x5_7(cv::Mat &src, cv::Mat &dst);
 
 /**
  * @brief Blur a color image using a 3x3 Gaussian kernel.
@@ -110,6 +114,17 @@ int blur5x5_5(cv::Mat &src, cv::Mat &dst);
  */
 int gauss3x3at(cv::Mat &src, cv::Mat &dst);
 
+/**
+ * @brief Blur a color image using a 7x7 Gaussian kernel.
+ *
+ * This function blurs a color image using the [1 6 15 20 15 6 1] binomial kernel in both directions.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int blur7x7(cv::Mat &src, cv::Mat &dst);
+
 /**
  * @brief Enhance vertical lines in an image using a 3x3 Sobel kernel.
  *
@@ -134,6 +149,42 @@ int sobelX3x3(cv::Mat &src, cv::Mat &dst);
  */
 int sobelY3x3(cv::Mat &src, cv::Mat &dst);
 
+/**
+ * @brief Enhance vertical lines in an image using a 3x3 Scharr kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int scharrX3x3(cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Enhance horizontal lines in an image using a 3x3 Scharr kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int scharrY3x3(cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Enhance vertical lines in an image using a 3x3 Prewitt kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int prewittX3x3(cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Enhance horizontal lines in an image using a 3x3 Prewitt kernel.
+ *
+ * @param src The source image.
+ * @param dst The destination image (CV_16SC3).
+ * @return 0 if successful, -1 if error.
+ */
+int prewittY3x3(cv::Mat &src, cv::Mat &dst);
+
 /**
  * @brief Calculate the gradient magnitude of an image.
  *
@@ -174,6 +225,19 @@ int magnitude(cv::Mat &src, cv::Mat &dst);
  */
 int blurQuantize(cv::Mat &src, cv::Mat &dst, int levels);
 
+/**
+ * @brief Smooth a color image with an edge preserving bilateral grid and quantize it to a specified number of levels.
+ *
+ * Cartoon version of blurQuantize. The bilateral grid flattens regions without smearing the edges between them, and
+ * each channel is then quantized into the given number of levels.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @param levels The number of levels to quantize the image to.
+ * @return 0 if successful, -1 if error.
+ */
+int bilateralQuantize(cv::Mat &src, cv::Mat &dst, int levels);
+
 /**
  * @brief Apply an emboss effect to an image.
  *
@@ -210,4 +274,123 @@ int adjustBrightness(cv::Mat &src, cv::Mat &dst, double brightness);
  */
 int negativeFilter(cv::Mat &src, cv::Mat &dst);
 
+// ==================== Allocation-free variants ====================
+//
+// The *Into functions write into a dst that the caller has already allocated with the size and type listed below. They
+// never allocate dst, and any temporaries come from a FramePool, so calling them every frame does not touch the heap
+// once the pool is warm. They return -1 if dst does not have the expected size and type. dst may be the same Mat as
+// src.
+
+/**
+ * @brief Convert a color image to greyscale into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @return 0 if successful, -1 if error.
+ */
+int greyscaleInto(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Convert a color image to sepia tone into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @return 0 if successful, -1 if error.
+ */
+int sepiaToneInto(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Blur a color image using separable 1x5 Gaussian kernels into a preallocated image.
+ *
+ * Produces the same result as blur5x5_2. The horizontal pass buffer is taken from the pool.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @param pool The pool to take the temporary buffer from.
+ * @return 0 if successful, -1 if error.
+ */
+int blur5x5_2Into(const cv::Mat &src, cv::Mat &dst, FramePool &pool = defaultFramePool());
+
+/**
+ * @brief Apply the 3x3 Sobel X kernel into a preallocated image. The one pixel border is set to 0.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_16SC3 with the size of src. Must not be src.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelX3x3Into(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Apply the 3x3 Sobel Y kernel into a preallocated image. The one pixel border is set to 0.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_16SC3 with the size of src. Must not be src.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelY3x3Into(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Calculate the gradient magnitude of an image into a preallocated image.
+ *
+ * The two Sobel images are taken from the pool.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @param pool The pool to take the temporary buffers from.
+ * @return 0 if successful, -1 if error.
+ */
+int magnitudeInto(const cv::Mat &src, cv::Mat &dst, FramePool &pool = defaultFramePool());
+
+/**
+ * @brief Adjust the brightness of an image into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @param brightness The brightness value to multiply each pixel by.
+ * @return 0 if successful, -1 if error.
+ */
+int adjustBrightnessInto(const cv::Mat &src, cv::Mat &dst, double brightness);
+
+/**
+ * @brief Create a negative of an image into a preallocated image.
+ *
+ * @param src The source image.
+ * @param dst The destination image, CV_8UC3 with the size of src.
+ * @return 0 if successful, -1 if error.
+ */
+int negativeFilterInto(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Convert a color image to greyscale in place.
+ *
+ * @param img The image to modify.
+ * @return 0 if successful, -1 if error.
+ */
+int greyscaleInPlace(cv::Mat &img);
+
+/**
+ * @brief Convert a color image to sepia tone in place.
+ *
+ * @param img The image to modify.
+ * @return 0 if successful, -1 if error.
+ */
+int sepiaToneInPlace(cv::Mat &img);
+
+/**
+ * @brief Adjust the brightness of an image in place.
+ *
+ * @param img The image to modify.
+ * @param brightness The brightness value to multiply each pixel by.
+ * @return 0 if successful, -1 if error.
+ */
+int adjustBrightnessInPlace(cv::Mat &img, double brightness);
+
+/**
+ * @brief Create a negative of an image in place.
+ *
+ * @param img The image to modify.
+ * @return 0 if successful, -1 if error.
+ */
+int negativeFilterInPlace(cv::Mat &img);
+
 #endif
\ No newline at end of file
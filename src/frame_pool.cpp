@@ -0,0 +1,136 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: A pool of reusable frame buffers so filters can get temporaries without allocating on every call.
+
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "frame_pool.h"
+
+/**
+ * @brief Get a buffer of the given shape, reusing a released one when possible.
+ *
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param type The OpenCV type, e.g. CV_8UC3.
+ * @return cv::Mat The buffer. Its contents are undefined.
+ */
+cv::Mat FramePool::acquire(int rows, int cols, int type)
+{
+    Key key = {rows, cols, type};
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<Key, std::vector<cv::Mat>>::iterator it = freeMats.find(key);
+        if (it != freeMats.end() && !it->second.empty())
+        {
+            cv::Mat mat = it->second.back();
+            it->second.pop_back();
+            freeBytes -= mat.total() * mat.elemSize();
+            return mat;
+        }
+    }
+
+    // Allocate outside of the lock, nothing was available for this shape
+    return cv::Mat(rows, cols, type);
+}
+
+/**
+ * @brief Get a buffer of the given shape, reusing a released one when possible.
+ *
+ * @param size The size of the buffer.
+ * @param type The OpenCV type, e.g. CV_8UC3.
+ * @return cv::Mat The buffer. Its contents are undefined.
+ */
+cv::Mat FramePool::acquire(cv::Size size, int type)
+{
+    return acquire(size.height, size.width, type);
+}
+
+/**
+ * @brief Return a buffer to the pool. The Mat header passed in is released. Buffers that cannot be pooled, or do not
+ * fit under the limits, are freed instead.
+ *
+ * @param mat The buffer to return.
+ */
+void FramePool::release(cv::Mat &mat)
+{
+    // Only pool a buffer this header owns outright, a view or a shared buffer could still be written by someone else
+    if (mat.empty() || mat.u == NULL || mat.u->refcount > 1 || mat.isSubmatrix() || !mat.isContinuous())
+    {
+        mat = cv::Mat();
+        return;
+    }
+
+    Key key = {mat.rows, mat.cols, mat.type()};
+    size_t bytes = mat.total() * mat.elemSize();
+
+    if (bytes > (size_t)FRAME_POOL_MAX_BYTES)
+    {
+        mat = cv::Mat();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<cv::Mat> &mats = freeMats[key];
+        if (mats.size() < FRAME_POOL_MAX_PER_SHAPE)
+        {
+            // Evict the oldest free buffers until the new one fits
+            std::map<Key, std::vector<cv::Mat>>::iterator it = freeMats.begin();
+            while (freeBytes + bytes > (size_t)FRAME_POOL_MAX_BYTES && it != freeMats.end())
+            {
+                if (it->second.empty())
+                {
+                    ++it;
+                    continue;
+                }
+                freeBytes -= it->second.front().total() * it->second.front().elemSize();
+                it->second.erase(it->second.begin());
+            }
+
+            mats.push_back(mat);
+            freeBytes += bytes;
+        }
+    }
+
+    mat = cv::Mat();
+}
+
+/**
+ * @brief Free every buffer held by the pool.
+ */
+void FramePool::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    freeMats.clear();
+    freeBytes = 0;
+}
+
+/**
+ * @brief Get the number of buffers currently held by the pool.
+ */
+size_t FramePool::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (std::map<Key, std::vector<cv::Mat>>::iterator it = freeMats.begin(); it != freeMats.end(); ++it)
+    {
+        count += it->second.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Get the process wide pool used by the filters when no pool is passed in.
+ *
+ * @return FramePool& The default pool.
+ */
+FramePool &defaultFramePool()
+{
+    static FramePool pool;
+    return pool;
+}
@@ -0,0 +1,128 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: A pool of reusable frame buffers so filters can get temporaries without allocating on every call.
+
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+// The number of free buffers kept for one shape
+#define FRAME_POOL_MAX_PER_SHAPE 4
+
+// The number of bytes the free buffers of one pool may hold in total
+#define FRAME_POOL_MAX_BYTES (256 << 20)
+
+/**
+ * @brief A thread safe pool of cv::Mat buffers keyed by rows, cols and type.
+ *
+ * acquire() hands out a previously released buffer of the same shape when one is available and only allocates when the
+ * pool for that shape is empty. The contents of an acquired buffer are undefined. A released buffer must not be used by
+ * the caller anymore since the next acquire() of the same shape returns it.
+ *
+ * At most FRAME_POOL_MAX_PER_SHAPE buffers are kept per shape and FRAME_POOL_MAX_BYTES in total; the oldest free
+ * buffers are evicted to stay under the byte limit. Only continuous buffers that are not a submatrix and are not shared
+ * with another Mat are pooled, anything else is simply released.
+ */
+class FramePool
+{
+  public:
+    /**
+     * @brief Get a buffer of the given shape, reusing a released one when possible.
+     *
+     * @param rows The number of rows.
+     * @param cols The number of columns.
+     * @param type The OpenCV type, e.g. CV_8UC3.
+     * @return cv::Mat The buffer. Its contents are undefined.
+     */
+    cv::Mat acquire(int rows, int cols, int type);
+
+    /**
+     * @brief Get a buffer of the given shape, reusing a released one when possible.
+     *
+     * @param size The size of the buffer.
+     * @param type The OpenCV type, e.g. CV_8UC3.
+     * @return cv::Mat The buffer. Its contents are undefined.
+     */
+    cv::Mat acquire(cv::Size size, int type);
+
+    /**
+     * @brief Return a buffer to the pool. The Mat header passed in is released. Buffers that cannot be pooled, or do
+     * not fit under the limits, are freed instead.
+     *
+     * @param mat The buffer to return.
+     */
+    void release(cv::Mat &mat);
+
+    /**
+     * @brief Free every buffer held by the pool.
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of buffers currently held by the pool.
+     */
+    size_t size();
+
+  private:
+    struct Key
+    {
+        int rows;
+        int cols;
+        int type;
+
+        bool operator<(const Key &other) const
+        {
+            if (rows != other.rows)
+                return rows < other.rows;
+            if (cols != other.cols)
+                return cols < other.cols;
+            return type < other.type;
+        }
+    };
+
+    std::map<Key, std::vector<cv::Mat>> freeMats;
+    size_t freeBytes = 0;
+    std::mutex mutex;
+};
+
+/**
+ * @brief Get the process wide pool used by the filters when no pool is passed in.
+ *
+ * @return FramePool& The default pool.
+ */
+FramePool &defaultFramePool();
+
+/**
+ * @brief Scoped buffer from a FramePool. The buffer goes back to the pool when the object goes out of scope.
+ */
+class PooledMat
+{
+  public:
+    PooledMat(FramePool &pool, int rows, int cols, int type) : pool(pool), mat(pool.acquire(rows, cols, type))
+    {
+    }
+
+    ~PooledMat()
+    {
+        pool.release(mat);
+    }
+
+    cv::Mat &get()
+    {
+        return mat;
+    }
+
+  private:
+    PooledMat(const PooledMat &);
+    PooledMat &operator=(const PooledMat &);
+
+    FramePool &pool;
+    cv::Mat mat;
+};
+
+#endif
@@ -17,6 +17,7 @@
 #include "feature_utils.h"
 #include "filter.h"
 #include "histogram_utils.h"
+#include "pyramid.h"
 
 /**
  * @brief Main function to find the top N matches for a target image in a directory of images
@@ -32,9 +33,11 @@ int main(int argc, char *argv[])
 {
     if (argc < 1)
     {
-        printf("Usage: %s <targetImage> [histogramType] \n", argv[0]);
+        printf("Usage: %s <targetImage> [histogramType] [normalizeLighting] [downscaleLevels]\n", argv[0]);
         printf("Histogram type: \n0 for RG Chromaticity \n1 for HSV \n2 for RG Chromaticity & HSV \n3 for color & "
                "texture \n4 for Deep Network Embedding \n5 for CBIR\n");
+        printf("Normalize lighting: 1 to apply CLAHE to every image before the color histograms\n");
+        printf("Downscale levels: halve every image this many times before the histograms, 0 by default\n");
         exit(-1);
     }
 
@@ -49,6 +52,8 @@ int main(int argc, char *argv[])
     char targetImagePath[256];
     char vectorCsv[256];
     int histogramType = 1;
+    bool normalizeLighting = false;
+    int downscaleLevels = 0;
     const int hBins = 30;
     const int sBins = 30;
     const int histSize = 30;
@@ -83,6 +88,35 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    if (argc > 3 && atoi(argv[3]) == 1)
+    {
+        printf("Normalizing lighting with CLAHE\n");
+        normalizeLighting = true;
+        equalizeClahe(image, image);
+    }
+
+    if (argc > 4)
+    {
+        downscaleLevels = atoi(argv[4]);
+        if (downscaleLevels < 0)
+        {
+            printf("Invalid downscale levels: %d\n", downscaleLevels);
+            return -1;
+        }
+    }
+
+    if (downscaleLevels > 0)
+    {
+        // Histograms are normalized, so a smaller image gives nearly the same histogram for a fraction of the work
+        std::vector<cv::Mat> pyramid;
+        if (buildPyramid5x5(image, pyramid, downscaleLevels) != 0)
+        {
+            return -1;
+        }
+        image = pyramid.back();
+        printf("Downscaled target image to %d x %d\n", image.cols, image.rows);
+    }
+
     if (histogramType == 5)
     {
         // Extract DNN feature vector for target image
@@ -160,9 +194,13 @@ int main(int argc, char *argv[])
         printf("\nCalculating Deep Network Embedding matches ...\n");
         dnnMatches = compareDeepNetworkEmbedding(resNetVectors, targetImagePath, buffer);
         printf("\nCalculating color matches ...\n");
-        histImageOneMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 3);
+        histImageOneMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 3, normalizeLighting,
+                              downscaleLevels);
         printf("\nCalculating texture matches ...\n");
-        histImageTwoMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 3);
+        histImageTwoMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 3, normalizeLighting,
+                              downscaleLevels);
     }
     if (histogramType == 4)
     {
@@ -174,31 +212,43 @@ int main(int argc, char *argv[])
     {
         printf("====================================\n");
         printf("Calculating color histograms ...\n");
-        histImageOneMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 3);
+        histImageOneMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 3, normalizeLighting,
+                              downscaleLevels);
         printf("====================================\n");
         printf("Calculating texture histograms ...\n");
-        histImageTwoMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 3);
+        histImageTwoMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 3, normalizeLighting,
+                              downscaleLevels);
     }
     if (histogramType == 2)
     {
         printf("====================================\n");
         printf("Calculating both HSV ...\n");
-        histImageOneMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 1);
+        histImageOneMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 1, normalizeLighting,
+                              downscaleLevels);
         printf("====================================\n");
         printf("Calculating RG Chromaticity ...\n");
-        histImageTwoMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 0);
+        histImageTwoMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 0, normalizeLighting,
+                              downscaleLevels);
     }
     if (histogramType == 1)
     {
         printf("====================================\n");
         printf("Calculating HSV histograms...\n");
-        histImageOneMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 1);
+        histImageOneMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistOne, buffer, 1, normalizeLighting,
+                              downscaleLevels);
     }
     if (histogramType == 0)
     {
         printf("====================================\n");
         printf("Calculating RG Chromaticity histograms...\n");
-        histImageTwoMatches = compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 0);
+        histImageTwoMatches =
+            compareHistograms(dp, dirPath, targetImagePath, targetHistTwo, buffer, 0, normalizeLighting,
+                              downscaleLevels);
     }
 
     std::vector<std::pair<std::string, float>> imageMatches;
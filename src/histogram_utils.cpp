@@ -9,6 +9,7 @@
 
 #include "filter.h"
 #include "histogram_utils.h"
+#include "pyramid.h"
 
 /**
  * @brief Calculate the intersection of two histograms
@@ -185,6 +186,187 @@ cv::Mat calcRgbHist(const cv::Mat &image, int histSize)
     return hist;
 }
 
+/**
+ * @brief Count the 256 intensity bins of a region of a single channel 8 bit image
+ *
+ * @param image The CV_8UC1 image
+ * @param roi The region to count
+ * @param counts The 256 bin counts, overwritten
+ */
+void calcIntensityCounts(const cv::Mat &image, const cv::Rect &roi, int *counts)
+{
+    // Four interleaved sub histograms so repeated values do not stall on the same counter
+    int sub[4][256] = {};
+
+    for (int i = roi.y; i < roi.y + roi.height; i++)
+    {
+        const uchar *ptr = image.ptr<uchar>(i) + roi.x;
+        int j = 0;
+        for (; j + 4 <= roi.width; j += 4)
+        {
+            sub[0][ptr[j]]++;
+            sub[1][ptr[j + 1]]++;
+            sub[2][ptr[j + 2]]++;
+            sub[3][ptr[j + 3]]++;
+        }
+        for (; j < roi.width; j++)
+        {
+            sub[0][ptr[j]]++;
+        }
+    }
+
+    for (int b = 0; b < 256; b++)
+    {
+        counts[b] = sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+    }
+}
+
+/**
+ * @brief Equalize a single channel 8 bit image with CLAHE
+ *
+ * @param src The CV_8UC1 source image
+ * @param dst The CV_8UC1 destination image, may be src
+ * @param clipLimit The maximum bin height as a multiple of the average bin height
+ * @param tilesX The number of tile columns
+ * @param tilesY The number of tile rows
+ */
+static void equalizeClaheChannel(const cv::Mat &src, cv::Mat &dst, float clipLimit, int tilesX, int tilesY)
+{
+    tilesX = std::max(1, std::min(tilesX, src.cols));
+    tilesY = std::max(1, std::min(tilesY, src.rows));
+    const int tileW = (src.cols + tilesX - 1) / tilesX;
+    const int tileH = (src.rows + tilesY - 1) / tilesY;
+    tilesX = (src.cols + tileW - 1) / tileW;
+    tilesY = (src.rows + tileH - 1) / tileH;
+
+    // One clipped equalization LUT per tile, built in parallel
+    std::vector<uchar> luts(tilesX * tilesY * 256);
+    cv::parallel_for_(cv::Range(0, tilesX * tilesY), [&](const cv::Range &range) {
+        int counts[256];
+        for (int t = range.start; t < range.end; t++)
+        {
+            cv::Rect roi((t % tilesX) * tileW, (t / tilesX) * tileH, 0, 0);
+            roi.width = std::min(tileW, src.cols - roi.x);
+            roi.height = std::min(tileH, src.rows - roi.y);
+            const int area = roi.width * roi.height;
+            calcIntensityCounts(src, roi, counts);
+
+            // Clip the bins and hand the excess back out evenly, the remainder one count per stride
+            if (clipLimit > 0)
+            {
+                int limit = std::max(1, static_cast<int>(clipLimit * area / 256));
+                int excess = 0;
+                for (int b = 0; b < 256; b++)
+                {
+                    if (counts[b] > limit)
+                    {
+                        excess += counts[b] - limit;
+                        counts[b] = limit;
+                    }
+                }
+                int share = excess / 256;
+                int remainder = excess % 256;
+                for (int b = 0; b < 256; b++)
+                {
+                    counts[b] += share;
+                }
+                if (remainder > 0)
+                {
+                    int stride = std::max(1, 256 / remainder);
+                    for (int b = 0; b < 256 && remainder > 0; b += stride, remainder--)
+                    {
+                        counts[b]++;
+                    }
+                }
+            }
+
+            uchar *lut = &luts[t * 256];
+            float scale = 255.0f / area;
+            int cdf = 0;
+            for (int b = 0; b < 256; b++)
+            {
+                cdf += counts[b];
+                lut[b] = cv::saturate_cast<uchar>(cdf * scale);
+            }
+        }
+    });
+
+    // Each column's pair of neighbouring tiles and the 8 bit weight of the right one, shared by every row
+    std::vector<int> colTile0(src.cols), colTile1(src.cols), colWeight(src.cols);
+    for (int x = 0; x < src.cols; x++)
+    {
+        float fx = (x + 0.5f) / tileW - 0.5f;
+        int tx = static_cast<int>(std::floor(fx));
+        colWeight[x] = static_cast<int>((fx - tx) * 256 + 0.5f);
+        colTile0[x] = std::max(tx, 0) * 256;
+        colTile1[x] = std::min(tx + 1, tilesX - 1) * 256;
+    }
+
+    dst.create(src.size(), CV_8UC1);
+
+    // Bilinear blend of the four neighbouring tile LUTs, in 16 bit fixed point
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++)
+        {
+            float fy = (y + 0.5f) / tileH - 0.5f;
+            int ty = static_cast<int>(std::floor(fy));
+            const int wy = static_cast<int>((fy - ty) * 256 + 0.5f);
+            const uchar *lutTop = &luts[std::max(ty, 0) * tilesX * 256];
+            const uchar *lutBottom = &luts[std::min(ty + 1, tilesY - 1) * tilesX * 256];
+
+            const uchar *ptr = src.ptr<uchar>(y);
+            uchar *ptrDst = dst.ptr<uchar>(y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                const int v = ptr[x];
+                const int wx = colWeight[x];
+                int top = (256 - wx) * lutTop[colTile0[x] + v] + wx * lutTop[colTile1[x] + v];
+                int bottom = (256 - wx) * lutBottom[colTile0[x] + v] + wx * lutBottom[colTile1[x] + v];
+                ptrDst[x] = static_cast<uchar>(((256 - wy) * top + wy * bottom + (1 << 15)) >> 16);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Apply contrast limited adaptive histogram equalization (CLAHE) to an image
+ *
+ * The image is split into a grid of tiles. Each tile gets a clipped histogram and an equalization LUT, and every pixel
+ * is mapped through the LUTs of the four nearest tiles with bilinear weights. Color images are equalized on the
+ * lightness channel of Lab so hue is left alone.
+ *
+ * @param src The CV_8UC1 or CV_8UC3 source image
+ * @param dst The destination image
+ * @param clipLimit The maximum bin height as a multiple of the average bin height
+ * @param tilesX The number of tile columns
+ * @param tilesY The number of tile rows
+ * @return 0 if successful, -1 if error.
+ */
+int equalizeClahe(const cv::Mat &src, cv::Mat &dst, float clipLimit, int tilesX, int tilesY)
+{
+    if (src.empty() || (src.type() != CV_8UC1 && src.type() != CV_8UC3))
+    {
+        printf("Frame is empty or not CV_8UC1 / CV_8UC3\n");
+        return -1;
+    }
+
+    if (src.channels() == 1)
+    {
+        equalizeClaheChannel(src, dst, clipLimit, tilesX, tilesY);
+        return 0;
+    }
+
+    cv::Mat lab;
+    std::vector<cv::Mat> channels;
+    cv::cvtColor(src, lab, cv::COLOR_BGR2Lab);
+    cv::split(lab, channels);
+    equalizeClaheChannel(channels[0], channels[0], clipLimit, tilesX, tilesY);
+    cv::merge(channels, lab);
+    cv::cvtColor(lab, dst, cv::COLOR_Lab2BGR);
+
+    return 0;
+}
+
 /**
  * @brief Calculate the cosine distance between two feature vectors
  *
@@ -272,10 +454,13 @@ std::vector<std::pair<std::string, float>> compareDeepNetworkEmbedding(
  * @param targetHist The target histogram
  * @param buffer The buffer for the image path
  * @param histType The type of histogram to calculate
+ * @param normalizeLighting Apply CLAHE to each image before calculating its histogram
+ * @param downscaleLevels Halve each image this many times with buildPyramid5x5 before calculating its histogram
  * @return std::vector<std::pair<std::string, float>> The list of image matches
  */
 std::vector<std::pair<std::string, float>> compareHistograms(struct dirent *dp, char *dirPath, char *targetImagePath,
-                                                             cv::Mat targetHist, char *buffer, int histType)
+                                                             cv::Mat targetHist, char *buffer, int histType,
+                                                             bool normalizeLighting, int downscaleLevels)
 {
     printf("\nProcessing images in directory ...");
     std::vector<std::pair<std::string, float>> imageMatches;
@@ -316,6 +501,21 @@ std::vector<std::pair<std::string, float>> compareHistograms(struct dirent *dp,
                 continue;
             }
 
+            if (normalizeLighting)
+            {
+                equalizeClahe(src, src);
+            }
+
+            if (downscaleLevels > 0)
+            {
+                std::vector<cv::Mat> pyramid;
+                if (buildPyramid5x5(src, pyramid, downscaleLevels) != 0)
+                {
+                    continue;
+                }
+                src = pyramid.back();
+            }
+
             cv::Mat srcHist;
 
             if (histType == 3)
@@ -54,6 +54,31 @@ cv::Mat calcHsvHist(const cv::Mat &hsvImage, int hBins, int sBins);
  */
 cv::Mat calcRgbHist(const cv::Mat &image, int histSize);
 
+/**
+ * @brief Count the 256 intensity bins of a region of a single channel 8 bit image
+ *
+ * @param image The CV_8UC1 image
+ * @param roi The region to count
+ * @param counts The 256 bin counts, overwritten
+ */
+void calcIntensityCounts(const cv::Mat &image, const cv::Rect &roi, int *counts);
+
+/**
+ * @brief Apply contrast limited adaptive histogram equalization (CLAHE) to an image
+ *
+ * The image is split into a grid of tiles. Each tile gets a clipped histogram and an equalization LUT, and every pixel
+ * is mapped through the LUTs of the four nearest tiles with bilinear weights. Color images are equalized on the
+ * lightness channel of Lab so hue is left alone.
+ *
+ * @param src The CV_8UC1 or CV_8UC3 source image
+ * @param dst The destination image
+ * @param clipLimit The maximum bin height as a multiple of the average bin height
+ * @param tilesX The number of tile columns
+ * @param tilesY The number of tile rows
+ * @return 0 if successful, -1 if error.
+ */
+int equalizeClahe(const cv::Mat &src, cv::Mat &dst, float clipLimit = 2.0f, int tilesX = 8, int tilesY = 8);
+
 /**
  * @brief Compare the histograms of images in a directory
  *
@@ -63,10 +88,13 @@ cv::Mat calcRgbHist(const cv::Mat &image, int histSize);
  * @param targetHist The target histogram
  * @param buffer The buffer for the image path
  * @param histType The type of histogram to calculate
+ * @param normalizeLighting Apply CLAHE to each image before calculating its histogram
+ * @param downscaleLevels Halve each image this many times with buildPyramid5x5 before calculating its histogram
  * @return std::vector<std::pair<std::string, float>> The list of image matches
  */
 std::vector<std::pair<std::string, float>> compareHistograms(struct dirent *dp, char *dirPath, char *targetImagePath,
-                                                             cv::Mat targetHist, char *buffer, int histType);
+                                                             cv::Mat targetHist, char *buffer, int histType,
+                                                             bool normalizeLighting = false, int downscaleLevels = 0);
 
 /**
  * @brief Creates the display histogram
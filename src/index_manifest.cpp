@@ -0,0 +1,271 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Manifest of the images behind a feature vector file, so feature_extract only extracts the images that are
+// new or changed since its last run.
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "index_manifest.h"
+
+static const uint64 HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64 HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 HASH_PRIME3 = 0x165667B19E3779F9ULL;
+
+static inline uint64 rotateLeft(uint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64 hashRound(uint64 lane, uint64 word)
+{
+    return rotateLeft(lane + word * HASH_PRIME2, 31) * HASH_PRIME1;
+}
+
+/**
+ * @brief Compute a fast 64 bit hash of the content of a file.
+ *
+ * Not cryptographic, 4 independent lanes of multiply and rotate over 8 byte words run at memory speed.
+ *
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return uint64 The hash.
+ */
+uint64 contentHash(const uchar *data, size_t size)
+{
+    uint64 lanes[4] = {HASH_PRIME1 + HASH_PRIME2, HASH_PRIME2, 0, 0 - HASH_PRIME1};
+    size_t i = 0;
+    uint64 word;
+
+    // 32 bytes at a time, the lanes do not depend on each other
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int l = 0; l < 4; l++)
+        {
+            memcpy(&word, data + i + 8 * l, 8);
+            lanes[l] = hashRound(lanes[l], word);
+        }
+    }
+
+    uint64 hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) +
+                  rotateLeft(lanes[3], 18) + (uint64)size;
+    for (; i + 8 <= size; i += 8)
+    {
+        memcpy(&word, data + i, 8);
+        hash = rotateLeft(hash ^ hashRound(0, word), 27) * HASH_PRIME1 + HASH_PRIME3;
+    }
+    for (; i < size; i++)
+    {
+        hash = rotateLeft(hash ^ (data[i] * HASH_PRIME3), 11) * HASH_PRIME1;
+    }
+
+    // mix the last bits into every bit
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * @brief Get the size and modification time of a file.
+ *
+ * @param path The path of the file.
+ * @param entry Receives the size and the modification time.
+ * @return 0 if successful, -1 if the file cannot be read.
+ */
+int statManifestEntry(const std::string &path, ManifestEntry &entry)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return -1;
+    }
+
+    entry.size = (long long)info.st_size;
+#ifdef __APPLE__
+    entry.mtime = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    entry.mtime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Get the absolute path of an image directory, so the same directory is recorded the same way however it is
+ * named on the command line.
+ *
+ * @param path The directory.
+ * @return std::string The absolute path without symbolic links, or path itself if it cannot be resolved.
+ */
+std::string manifestDirectory(const std::string &path)
+{
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) == NULL)
+    {
+        return path;
+    }
+    return std::string(resolved);
+}
+
+/**
+ * @brief Read a manifest file.
+ *
+ * @param filename The manifest file.
+ * @param manifest Receives the entries by image file name, empty if the file does not exist.
+ * @param directory Receives the image directory of the entries, empty if the manifest does not record one.
+ * @return 0 if successful, -1 if the file is not a manifest.
+ */
+int readManifest(const std::string &filename, Manifest &manifest, std::string &directory)
+{
+    manifest.clear();
+    directory.clear();
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+
+    char line[1024];
+    if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, MANIFEST_HEADER, strlen(MANIFEST_HEADER)) != 0)
+    {
+        printf("error: %s is not a manifest\n", filename.c_str());
+        fclose(fp);
+        return -1;
+    }
+
+    // size mtime hash deleted name, the name last so it may hold any character but a newline
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (strncmp(line, MANIFEST_DIRECTORY, strlen(MANIFEST_DIRECTORY)) == 0)
+        {
+            const char *path = line + strlen(MANIFEST_DIRECTORY);
+            directory.assign(path, strcspn(path, "\n"));
+            continue;
+        }
+
+        ManifestEntry entry;
+        unsigned long long hash;
+        int deleted, name;
+        if (sscanf(line, "%lld %lld %llx %d %n", &entry.size, &entry.mtime, &hash, &deleted, &name) != 4)
+        {
+            continue;
+        }
+        entry.hash = hash;
+        entry.deleted = deleted != 0;
+
+        size_t length = strcspn(line + name, "\n");
+        if (length > 0)
+        {
+            manifest[std::string(line + name, length)] = entry;
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Write a manifest file, replacing the previous one only once the new one is complete.
+ *
+ * @param filename The manifest file.
+ * @param manifest The entries.
+ * @param directory The image directory of the entries, as returned by manifestDirectory.
+ * @return 0 if successful, -1 if error.
+ */
+int writeManifest(const std::string &filename, const Manifest &manifest, const std::string &directory)
+{
+    std::string temporary = filename + ".tmp";
+    FILE *fp = fopen(temporary.c_str(), "w");
+    if (fp == NULL)
+    {
+        printf("error: unable to open %s\n", temporary.c_str());
+        return -1;
+    }
+
+    fprintf(fp, "%s\n", MANIFEST_HEADER);
+    fprintf(fp, "%s%s\n", MANIFEST_DIRECTORY, directory.c_str());
+    for (Manifest::const_iterator it = manifest.begin(); it != manifest.end(); ++it)
+    {
+        const ManifestEntry &entry = it->second;
+        fprintf(fp, "%lld %lld %016llx %d %s\n", entry.size, entry.mtime, (unsigned long long)entry.hash,
+                entry.deleted ? 1 : 0, it->first.c_str());
+    }
+
+    bool failed = ferror(fp) != 0;
+    if (fclose(fp) != 0 || failed || rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        printf("error: unable to write %s\n", filename.c_str());
+        remove(temporary.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Find the row of every manifest entry in a feature vector file written by feature_extract.
+ *
+ * Rows whose image is not in the manifest are ignored, entries without a row keep rowOffset -1.
+ *
+ * @param filename The feature vector file.
+ * @param manifest The entries, receive the offset and length of their row.
+ * @return int The number of rows found, 0 if the file does not exist.
+ */
+int indexFeatureRows(const std::string &filename, Manifest &manifest)
+{
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+
+    // only the image name at the start of every row is needed, the rest is skipped a buffer at a time
+    std::vector<char> buffer(1 << 16);
+    std::string name;
+    bool inName = true;
+    long long offset = 0, rowStart = 0;
+    int found = 0;
+    size_t n;
+    while ((n = fread(&buffer[0], 1, buffer.size(), fp)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            char c = buffer[i];
+            if (c == '\n')
+            {
+                Manifest::iterator it = manifest.find(name);
+                if (it != manifest.end())
+                {
+                    it->second.rowOffset = rowStart;
+                    it->second.rowLength = (int)(offset + (long long)i + 1 - rowStart);
+                    found++;
+                }
+                name.clear();
+                inName = true;
+                rowStart = offset + (long long)i + 1;
+            }
+            else if (inName)
+            {
+                if (c == ',')
+                {
+                    inName = false;
+                }
+                else
+                {
+                    name += c;
+                }
+            }
+        }
+        offset += (long long)n;
+    }
+
+    fclose(fp);
+    return found;
+}
@@ -0,0 +1,104 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Manifest of the images behind a feature vector file, so feature_extract only extracts the images that are
+// new or changed since its last run.
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <unordered_map>
+
+#ifndef INDEX_MANIFEST_H
+#define INDEX_MANIFEST_H
+
+// First line of a manifest file, changes when the format does
+#define MANIFEST_HEADER "# feature_extract manifest 1"
+
+// Second line of a manifest file, followed by the image directory the entries are relative to. Manifests written
+// before it was added have no directory and never match one.
+#define MANIFEST_DIRECTORY "# directory "
+
+/**
+ * @brief What the manifest knows about one image file.
+ *
+ * An image is unchanged if its size and modification time match. If only the time differs, the content hash tells
+ * whether it was touched or rewritten. Deleted images stay in the manifest as tombstones.
+ */
+struct ManifestEntry
+{
+    long long size;
+    long long mtime; // nanoseconds since the epoch
+    uint64 hash;     // contentHash of the file
+    bool deleted;
+
+    // Not stored in the manifest file, found by indexFeatureRows
+    long long rowOffset; // byte offset of the row of the image in the feature vector file, -1 if it has none
+    int rowLength;       // length of the row including the newline
+
+    ManifestEntry() : size(0), mtime(0), hash(0), deleted(false), rowOffset(-1), rowLength(0)
+    {
+    }
+};
+
+typedef std::unordered_map<std::string, ManifestEntry> Manifest;
+
+/**
+ * @brief Compute a fast 64 bit hash of the content of a file.
+ *
+ * Not cryptographic, 4 independent lanes of multiply and rotate over 8 byte words run at memory speed.
+ *
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return uint64 The hash.
+ */
+uint64 contentHash(const uchar *data, size_t size);
+
+/**
+ * @brief Get the size and modification time of a file.
+ *
+ * @param path The path of the file.
+ * @param entry Receives the size and the modification time.
+ * @return 0 if successful, -1 if the file cannot be read.
+ */
+int statManifestEntry(const std::string &path, ManifestEntry &entry);
+
+/**
+ * @brief Get the absolute path of an image directory, so the same directory is recorded the same way however it is
+ * named on the command line.
+ *
+ * @param path The directory.
+ * @return std::string The absolute path without symbolic links, or path itself if it cannot be resolved.
+ */
+std::string manifestDirectory(const std::string &path);
+
+/**
+ * @brief Read a manifest file.
+ *
+ * @param filename The manifest file.
+ * @param manifest Receives the entries by image file name, empty if the file does not exist.
+ * @param directory Receives the image directory of the entries, empty if the manifest does not record one.
+ * @return 0 if successful, -1 if the file is not a manifest.
+ */
+int readManifest(const std::string &filename, Manifest &manifest, std::string &directory);
+
+/**
+ * @brief Write a manifest file, replacing the previous one only once the new one is complete.
+ *
+ * @param filename The manifest file.
+ * @param manifest The entries.
+ * @param directory The image directory of the entries, as returned by manifestDirectory.
+ * @return 0 if successful, -1 if error.
+ */
+int writeManifest(const std::string &filename, const Manifest &manifest, const std::string &directory);
+
+/**
+ * @brief Find the row of every manifest entry in a feature vector file written by feature_extract.
+ *
+ * Rows whose image is not in the manifest are ignored, entries without a row keep rowOffset -1.
+ *
+ * @param filename The feature vector file.
+ * @param manifest The entries, receive the offset and length of their row.
+ * @return int The number of rows found, 0 if the file does not exist.
+ */
+int indexFeatureRows(const std::string &filename, Manifest &manifest);
+
+#endif
@@ -3,7 +3,8 @@
   Kevin Heleodoro
   February 2,2024
 
-  Edits include the addition of the main function to run kmeans.
+  Edits include the addition of the main function to run kmeans, which now lives in produce_kmeans.cpp so that other
+  programs can link the kmeans functions.
 
   ====================================================================================================
 
@@ -15,196 +16,1023 @@
   Implementation of a K-means algorithm
 */
 
+#include <atomic>
 #include <cstdio>
+#include <cfloat>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <opencv2/opencv.hpp>
 
 #include "kmeans.h"
+#include "kmeans_core.h"
+#include "nearest_color.h"
+#include "quantize.h"
+
+// Data points per block of the parallel loops. Every block draws from its own RNG seeded from the block index, so the
+// sampled seeds do not depend on the number of threads.
+#define KMEANS_BLOCK 4096
+
+// Slack added to every bound so floating point rounding can only loosen them. Distinct distances between integer
+// colors differ by more than 0.001, so the slack never hides a closer mean.
+static const double BOUND_SLACK = 1e-6;
+
+/*
+  The metric of kmeans_core.h for pixels: the integer SSD between Vec3b colors, so every distance is exact and only the
+  square roots taken for the bounds need BOUND_SLACK.
+ */
+struct ColorMetric
+{
+    typedef int Dist;
+    typedef std::vector<cv::Vec3b> Points;
+    typedef std::vector<cv::Vec3b> Seeds;
+    typedef const std::vector<cv::Vec3b> &CandidateView;
+    enum
+    {
+        BLOCK = KMEANS_BLOCK
+    };
+
+    size_t rows(const Points &points) const
+    {
+        return points.size();
+    }
+
+    size_t seedCount(const Seeds &seeds) const
+    {
+        return seeds.size();
+    }
+
+    int distance(const Points &points, size_t j, const Seeds &seeds, size_t s) const
+    {
+        return SSD(seeds[s], points[j]);
+    }
+
+    int centerDistance(const Seeds &means, int a, int b) const
+    {
+        return SSD(means[a], means[b]);
+    }
+
+    void addSeed(const Points &points, size_t j, Seeds &seeds) const
+    {
+        seeds.push_back(points[j]);
+    }
+
+    CandidateView candidates(const Seeds &seeds) const
+    {
+        return seeds;
+    }
+
+    double upperBound(int ssd) const
+    {
+        return std::sqrt((double)ssd) + BOUND_SLACK;
+    }
+
+    double lowerBound(int ssd) const
+    {
+        return std::sqrt((double)ssd) - BOUND_SLACK;
+    }
+
+    double halfBound(int ssd) const
+    {
+        return 0.5 * std::sqrt((double)ssd) - BOUND_SLACK;
+    }
+
+    double shiftSlack() const
+    {
+        return BOUND_SLACK;
+    }
+};
 
 /*
   data: a std::vector of pixels
-  means: a std:vector of means, will contain the cluster means when the function returns
-  labels: an allocated array of type int, the same size as the data, contains the labels when the function returns
+  means: a std:vector of means, will contain the K seeds when the function returns
   K: the number of clusters
-  maxIterations: maximum number of E-M interactions, default is 10
-  stopThresh: if the means change less than the threshold, the E-M loop terminates, default is 0
+  seeding: KMEANS_SEED_COMB, KMEANS_SEED_PLUSPLUS or KMEANS_SEED_PARALLEL
+  rng: the random number generator, the seeds only depend on its state
 
-  Executes K-means clustering on the data
+  Picks the K initial means for kmeans
  */
-int kmeans(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int *labels, int K, int maxIterations,
-           int stopThresh)
+int kmeansSeed(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int K, int seeding, cv::RNG &rng)
 {
-    // error checking
-    if (K > data.size())
+    if (K < 1 || K > (int)data.size())
     {
-        printf("error: K must be less than the number of data points\n");
+        printf("error: K must be in [1, number of data points]\n");
         return (-1);
     }
 
-    // clear the means vector
-    printf("Clearing means vector ...\n");
-    means.clear();
+    kmeansSeedCenters(ColorMetric(), data, means, K, seeding, rng);
+    return (0);
+}
 
-    // initialize the K mean values
-    // use comb sampling to select K values
-    printf("Initializing K mean values ...\n");
-    int delta = data.size() / K;
-    printf("delta: %d\n", delta);
+/*
+  data: a std::vector of pixels
+  means: the current means
+  labels: receives the labels of the pixels
+  begin, end: the range of pixels to assign
 
-    // We need to account for the case where the result of data.size() % K is 0.
-    int d_size = (data.size() % K) > 0 ? data.size() % K : 1;
-    int istep = rand() % d_size;
-    printf("istep: %d\n", istep);
-    for (int i = 0; i < K; i++)
+  The naive assignment. The pixels are converted to the layout of nearestColors one block at a time, so the search reads
+  a block that is still in cache and no second copy of the whole data is kept. nearestColors writes int labels, which
+  go through a buffer of one block.
+ */
+template <typename L>
+static void assignNearest(const std::vector<cv::Vec3b> &data, const std::vector<cv::Vec3b> &means, L *labels,
+                          size_t begin, size_t end)
+{
+    ColorPlanes planes;
+    int buffer[KMEANS_BLOCK];
+    for (size_t first = begin; first < end; first += KMEANS_BLOCK)
     {
-        int index = (istep + i * delta) % data.size();
-        means.push_back(data[index]);
+        size_t last = std::min(end, first + KMEANS_BLOCK);
+        toColorPlanes(&data[first], last - first, planes);
+        nearestColors(planes, 0, last - first, means, buffer);
+        for (size_t j = first; j < last; j++)
+        {
+            labels[j] = (L)buffer[j - first];
+        }
+    }
+}
+
+/*
+  K: the number of clusters
+
+  Picks the assignment method for KMEANS_ASSIGN_AUTO. With 3 channels an SSD costs about as much as checking one of
+  Elkan's bounds, and reading its N x K bounds costs more than it saves, so Hamerly is the fastest scalar method for
+  every K that was measured (8 to 256). The SIMD naive search computes a register of SSDs in the time Hamerly checks the
+  bounds of one pixel and was faster than it for all of those K, so it is used whenever it is available.
+ */
+static int chooseAssignment(int K)
+{
+    return K < 2 || nearestColorsSimd() ? KMEANS_ASSIGN_NAIVE : KMEANS_ASSIGN_HAMERLY;
+}
+
+/*
+  data: a std::vector of pixels
+  weights: the weight of each pixel, or NULL for all ones
+  means: the initial means, will contain the cluster means when the function returns
+  labels: an allocated array of int, uchar or ushort wide enough for K, the same size as the data, contains the labels
+          when the function returns
+  maxIterations: maximum number of E-M interactions
+  stopThresh: if the means change less than the threshold, the E-M loop terminates
+  assignment: KMEANS_ASSIGN_AUTO, KMEANS_ASSIGN_NAIVE, KMEANS_ASSIGN_HAMERLY or KMEANS_ASSIGN_ELKAN
+  stats: if not NULL, receives the number of iterations and the final inertia
+  changeThresh: if the fraction of labels that changed in an iteration is at most the threshold, the E-M loop
+                terminates, negative to disable
+  labelsValid: true if labels holds the labels of a previous run, whose changes count in the first iteration
+  cancelAbove: if not NULL, the run is cancelled once the inertia of the current labels about their means is above
+               this after KMEANS_RESTART_GRACE iterations. It may be lowered by another thread while the run goes on.
+  verbose: if false, nothing is printed
+
+  Runs the E-M iterations of kmeans from the given means. A point with weight w counts as w copies of it. Both steps of
+  each iteration run in parallel and the result is the same for any number of threads. Returns -1 if the run was
+  cancelled, 0 otherwise.
+ */
+template <typename L>
+static int lloyd(const std::vector<cv::Vec3b> &data, const std::vector<int> *weights, std::vector<cv::Vec3b> &means,
+                 L *labels, int maxIterations, int stopThresh, int assignment, KmeansStats *stats,
+                 double changeThresh = -1, bool labelsValid = false, const std::atomic<double> *cancelAbove = NULL,
+                 bool verbose = true)
+{
+    const int K = means.size();
+    if (assignment == KMEANS_ASSIGN_AUTO)
+    {
+        assignment = chooseAssignment(K);
+    }
+
+    // bounds kept across iterations by the Hamerly and Elkan assignments, and how far each mean moved
+    std::vector<double> upper, lower;
+    std::vector<float> lowerElkan;
+    std::vector<double> shift(K, 0), drift(K, 0);
+    std::vector<double> half, halfMin;
+    if (assignment == KMEANS_ASSIGN_HAMERLY)
+    {
+        upper.resize(data.size());
+        lower.resize(data.size());
+    }
+    else if (assignment == KMEANS_ASSIGN_ELKAN)
+    {
+        upper.resize(data.size());
+        lowerElkan.resize(data.size() * K);
+    }
+
+    // split the data into one stripe of whole blocks per thread, so two threads share at most the cache line at a
+    // stripe boundary of the labels and bounds. Each stripe sums its points into its own accumulators, and since the
+    // sums are integers the reduced means do not depend on the number of threads.
+    int blocks = (int)((data.size() + KMEANS_BLOCK - 1) / KMEANS_BLOCK);
+    int stripes = std::max(1, std::min(cv::getNumThreads(), blocks));
+    size_t stripeSize = (size_t)((blocks + stripes - 1) / stripes) * KMEANS_BLOCK;
+    std::vector<std::vector<cv::Vec<int64, 4> > > partial(stripes);
+
+    // the labels before each assignment, to count how many changed
+    std::vector<L> previous;
+    std::vector<size_t> partialChanged(stripes, 0);
+    if (changeThresh >= 0)
+    {
+        previous.resize(data.size());
+    }
+
+    // the sum of the squared norms of the data, the inertia about the exact means of the clusters is this minus
+    // |sum|^2 / count of every cluster
+    double squaredNorms = 0;
+    if (cancelAbove != NULL)
+    {
+        for (size_t j = 0; j < data.size(); j++)
+        {
+            squaredNorms += (double)(weights ? (*weights)[j] : 1) *
+                            (data[j][0] * data[j][0] + data[j][1] * data[j][1] + data[j][2] * data[j][2]);
+        }
     }
-    // have K initial means
 
     // loop the E-M steps
+    int iterations = 0;
     for (int i = 0; i < maxIterations; i++)
     {
+        iterations++;
 
-        // classify each data point using SSD
-        printf("\nClassifying each data point using SSD ...\n");
-        for (int j = 0; j < data.size(); j++)
+        if (assignment == KMEANS_ASSIGN_HAMERLY || assignment == KMEANS_ASSIGN_ELKAN)
         {
-            int minssd = SSD(means[0], data[j]);
-            int minidx = 0;
-            for (int k = 1; k < K; k++)
+            kmeansHalfCenterDistances(ColorMetric(), means, K, half, halfMin);
+        }
+
+        // classify each data point using SSD and accumulate the sums of each cluster
+        if (verbose)
+        {
+            printf("\nClassifying each data point using SSD ...\n");
+        }
+        cv::parallel_for_(
+            cv::Range(0, stripes),
+            [&](const cv::Range &range) {
+                for (int s = range.start; s < range.end; s++)
+                {
+                    size_t begin = s * stripeSize;
+                    size_t end = std::min(data.size(), begin + stripeSize);
+                    if (!previous.empty())
+                    {
+                        std::copy(labels + begin, labels + end, previous.begin() + begin);
+                    }
+                    if (assignment == KMEANS_ASSIGN_HAMERLY)
+                    {
+                        kmeansAssignHamerly(ColorMetric(), data, means, K, labels, upper, lower, shift, halfMin, begin,
+                                            end, i == 0);
+                    }
+                    else if (assignment == KMEANS_ASSIGN_ELKAN)
+                    {
+                        kmeansAssignElkan(ColorMetric(), data, means, K, labels, upper, lowerElkan, shift, drift, half,
+                                          halfMin, begin, end, i == 0);
+                    }
+                    else
+                    {
+                        assignNearest(data, means, labels, begin, end);
+                    }
+                    if (!previous.empty())
+                    {
+                        size_t changed = 0;
+                        for (size_t j = begin; j < end; j++)
+                        {
+                            changed += labels[j] != previous[j];
+                        }
+                        partialChanged[s] = changed;
+                    }
+
+                    std::vector<cv::Vec<int64, 4> > &sums = partial[s];
+                    sums.assign(K, cv::Vec<int64, 4>(0, 0, 0, 0));
+                    for (size_t j = begin; j < end; j++)
+                    {
+                        cv::Vec<int64, 4> &t = sums[labels[j]];
+                        int64 w = weights ? (*weights)[j] : 1;
+                        t[0] += w * data[j][0];
+                        t[1] += w * data[j][1];
+                        t[2] += w * data[j][2];
+                        t[3] += w; // counter
+                    }
+                }
+            },
+            stripes);
+
+        // calculate the new means
+        if (verbose)
+        {
+            printf("Calculating new means ...\n");
+        }
+        std::vector<cv::Vec<int64, 4> > tmeans(means.size(), cv::Vec<int64, 4>(0, 0, 0, 0)); // initialize with zeros
+        for (int s = 0; s < stripes; s++)
+        {
+            for (int k = 0; k < K; k++)
             {
-                int tssd = SSD(means[k], data[j]);
-                if (tssd < minssd)
+                for (int c = 0; c < 4; c++)
                 {
-                    minssd = tssd;
-                    minidx = k;
+                    tmeans[k][c] += partial[s][k][c];
                 }
             }
-            labels[j] = minidx;
         }
 
-        // calculate the new means
-        printf("Calculating new means ...\n");
-        std::vector<cv::Vec4i> tmeans(means.size(), cv::Vec4i(0, 0, 0, 0)); // initialize with zeros
-        for (int j = 0; j < data.size(); j++)
+        // stop a run that is clearly worse than the best one so far
+        if (cancelAbove != NULL && iterations >= KMEANS_RESTART_GRACE)
         {
-            tmeans[labels[j]][0] += data[j][0];
-            tmeans[labels[j]][1] += data[j][1];
-            tmeans[labels[j]][2] += data[j][2];
-            tmeans[labels[j]][3]++; // counter
+            double current = squaredNorms;
+            for (int k = 0; k < K; k++)
+            {
+                if (tmeans[k][3] > 0)
+                {
+                    current -= ((double)tmeans[k][0] * tmeans[k][0] + (double)tmeans[k][1] * tmeans[k][1] +
+                                (double)tmeans[k][2] * tmeans[k][2]) /
+                               tmeans[k][3];
+                }
+            }
+            if (current > cancelAbove->load())
+            {
+                if (verbose)
+                {
+                    printf("Cancelled after %d iterations, inertia: %.0f\n", iterations, current);
+                }
+                return (-1);
+            }
         }
 
         int sum = 0;
-        printf("Updating means ...\n");
+        if (verbose)
+        {
+            printf("Updating means ...\n");
+        }
         for (int k = 0; k < tmeans.size(); k++)
         {
-            int divisor = tmeans[k][3] > 0 ? tmeans[k][3] : 1;
-            // tmeans[k][0] /= tmeans[k][3];
-            // tmeans[k][1] /= tmeans[k][3];
-            // tmeans[k][2] /= tmeans[k][3];
-            tmeans[k][0] /= divisor;
-            tmeans[k][1] /= divisor;
-            tmeans[k][2] /= divisor;
+            int64 divisor = tmeans[k][3] > 0 ? tmeans[k][3] : 1;
+            cv::Vec3i mean((int)(tmeans[k][0] / divisor), (int)(tmeans[k][1] / divisor), (int)(tmeans[k][2] / divisor));
 
             // compute the SSD between the new and old means
-            sum += SSD(tmeans[k], means[k]);
+            int moved = SSD(mean, means[k]);
+            sum += moved;
+            shift[k] = std::sqrt((double)moved);
+            drift[k] += shift[k];
 
-            means[k][0] = tmeans[k][0]; // update the mean
-            means[k][1] = tmeans[k][1]; // update the mean
-            means[k][2] = tmeans[k][2]; // update the mean
+            means[k][0] = mean[0]; // update the mean
+            means[k][1] = mean[1]; // update the mean
+            means[k][2] = mean[2]; // update the mean
         }
 
         // check if we can stop early
-        printf("Iteration %d, sum: %d\n\n", i, sum);
+        if (verbose)
+        {
+            printf("Iteration %d, sum: %d\n\n", i, sum);
+        }
         if (sum <= stopThresh)
         {
             break;
         }
+        if (changeThresh >= 0)
+        {
+            size_t changed = 0;
+            for (int s = 0; s < stripes; s++)
+            {
+                changed += partialChanged[s];
+            }
+            if (i == 0 && !labelsValid)
+            {
+                changed = data.size();
+            }
+            if (changed <= changeThresh * data.size())
+            {
+                break;
+            }
+        }
     }
 
     // the labels and updated means are the final values
+    std::vector<int64> partialInertia(stripes, 0);
+    cv::parallel_for_(
+        cv::Range(0, stripes),
+        [&](const cv::Range &range) {
+            for (int s = range.start; s < range.end; s++)
+            {
+                size_t end = std::min(data.size(), (s + 1) * stripeSize);
+                int64 t = 0;
+                for (size_t j = s * stripeSize; j < end; j++)
+                {
+                    t += (int64)SSD(means[labels[j]], data[j]) * (weights ? (*weights)[j] : 1);
+                }
+                partialInertia[s] = t;
+            }
+        },
+        stripes);
+    double inertia = 0;
+    for (int s = 0; s < stripes; s++)
+    {
+        inertia += partialInertia[s];
+    }
+    if (verbose)
+    {
+        printf("Converged after %d iterations, inertia: %.0f\n", iterations, inertia);
+    }
+    if (stats != NULL)
+    {
+        stats->iterations = iterations;
+        stats->inertia = inertia;
+    }
 
     return (0);
 }
 
-int main(int argc, char *argv[])
+/*
+  kmeans for labels of type L, int, uchar or ushort
+ */
+template <typename L>
+static int kmeansRun(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, L *labels, int K, int maxIterations,
+                     int stopThresh, int seeding, uint64 seed, int assignment, KmeansStats *stats, bool verbose)
 {
-    if (argc < 1)
+    // error checking
+    if (K > data.size())
+    {
+        printf("error: K must be less than the number of data points\n");
+        return (-1);
+    }
+
+    // initialize the K mean values
+    if (verbose)
+    {
+        printf("Initializing K mean values ...\n");
+    }
+    cv::RNG rng(seed);
+    if (kmeansSeed(data, means, K, seeding, rng) != 0)
     {
-        printf("Usage: %s <image filename> <# of colors>\n", argv[0]);
-        exit(-1);
+        return (-1);
     }
+    // have K initial means
+
+    lloyd(data, NULL, means, labels, maxIterations, stopThresh, assignment, stats, -1, false, NULL, verbose);
+
+    return (0);
+}
+
+/*
+  data: a std::vector of pixels
+  means: a std:vector of means, will contain the cluster means when the function returns
+  labels: an allocated array of type int, the same size as the data, contains the labels when the function returns. The
+          cv::Mat overload stores narrower labels instead
+  K: the number of clusters
+  maxIterations: maximum number of E-M interactions, default is 10
+  stopThresh: if the means change less than the threshold, the E-M loop terminates, default is 0
+  seeding: how the initial means are picked, KMEANS_SEED_COMB (default), KMEANS_SEED_PLUSPLUS or KMEANS_SEED_PARALLEL
+  seed: seed of the random number generator, the same seed gives the same result
+  assignment: KMEANS_ASSIGN_AUTO (default), KMEANS_ASSIGN_NAIVE, KMEANS_ASSIGN_HAMERLY or KMEANS_ASSIGN_ELKAN, all
+              give the same labels
+  stats: if not NULL, receives the number of iterations and the final inertia
+  verbose: if false, only errors are printed, for callers that cluster many images. Default is true
+
+  Executes K-means clustering on the data. Both steps of each iteration run in parallel and the result is the same for
+  any number of threads.
+ */
+int kmeans(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int *labels, int K, int maxIterations,
+           int stopThresh, int seeding, uint64 seed, int assignment, KmeansStats *stats, bool verbose)
+{
+    return kmeansRun(data, means, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats, verbose);
+}
+
+/*
+  K: the number of clusters
+
+  Returns the narrowest label depth that holds K labels: CV_8U for K <= 256, CV_16U for K <= 65536, CV_32S otherwise
+ */
+int kmeansLabelDepth(int K)
+{
+    return K <= 256 ? CV_8U : K <= 65536 ? CV_16U : CV_32S;
+}
 
-    srand(time(NULL));
+/*
+  labels: the labels, kept if it already has one element per data point of depth kmeansLabelDepth(K), so it can be
+          shaped like the image, otherwise created as a column
+  the other parameters are the same as for kmeans with an int array of labels
 
-    printf("\n\n========== K-means Clustering ==========\n\n");
-    char filename[256];
+  Executes K-means clustering on the data with labels of 1 or 2 bytes for K up to 256 or 65536 instead of 4
+ */
+int kmeans(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, cv::Mat &labels, int K, int maxIterations,
+           int stopThresh, int seeding, uint64 seed, int assignment, KmeansStats *stats, bool verbose)
+{
+    int depth = kmeansLabelDepth(K);
+    if (labels.total() != data.size() || labels.type() != depth || !labels.isContinuous())
+    {
+        labels.create((int)data.size(), 1, depth);
+    }
 
-    strcpy(filename, argv[1]);
-    printf("Image set to %s\n", filename);
-    cv::Mat image = cv::imread(filename);
-    cv::Mat original = image.clone();
-    if (image.empty())
+    if (depth == CV_8U)
     {
-        printf("No image data\n");
-        return -1;
+        return kmeansRun(data, means, labels.ptr<uchar>(), K, maxIterations, stopThresh, seeding, seed, assignment,
+                         stats, verbose);
     }
+    if (depth == CV_16U)
+    {
+        return kmeansRun(data, means, labels.ptr<ushort>(), K, maxIterations, stopThresh, seeding, seed, assignment,
+                         stats, verbose);
+    }
+    return kmeansRun(data, means, labels.ptr<int>(), K, maxIterations, stopThresh, seeding, seed, assignment, stats,
+                     verbose);
+}
 
-    // kmeans clustering
-    int K = atoi(argv[2]);
-    printf("Number of colors set to %d\n", K);
-    std::vector<cv::Vec3b> data;
-    std::vector<cv::Vec3b> means;
+/*
+  labels: the labels of one image row
+  packed: every palette color in the low 3 bytes of a 4 byte word
+  dst: the destination row
+  cols: the number of pixels in the row
+
+  Writes the palette color of every label of a row. Each pixel is stored as one 4 byte word whose last byte is
+  overwritten by the next pixel, so the loop is a load, a gather and a store per pixel. The last pixel is written with
+  3 bytes so the row does not overflow.
+ */
+template <typename L> static void writeLabelRow(const L *labels, const uint32_t *packed, uchar *dst, int cols)
+{
+    int j = 0;
+    for (; j < cols - 1; j++)
+    {
+        memcpy(dst + 3 * j, &packed[labels[j]], 4);
+    }
+    if (j < cols)
+    {
+        memcpy(dst + 3 * j, &packed[labels[j]], 3);
+    }
+}
 
-    printf("Creating labels ...\n");
-    int *labels = new int[image.rows * image.cols];
+/*
+  labels: CV_8U, CV_16U or CV_32S labels, one per pixel, every label less than the size of the palette
+  palette: the colors of the labels, the means of kmeans
+  dst: receives a CV_8UC3 image of the same size as labels with the palette color of every label
 
-    printf("Extracting pixels from image ...\n");
-    for (int i = 0; i < image.rows; i++)
+  Maps labels to palette colors in one pass over the rows, in parallel. A column of labels of an image with rows rows
+  can be reshaped first with labels.reshape(1, rows).
+ */
+int writeLabelColors(const cv::Mat &labels, const std::vector<cv::Vec3b> &palette, cv::Mat &dst)
+{
+    int depth = labels.depth();
+    if (labels.empty() || labels.channels() != 1 || (depth != CV_8U && depth != CV_16U && depth != CV_32S) ||
+        palette.empty())
     {
-        for (int j = 0; j < image.cols; j++)
+        printf("error: writeLabelColors needs CV_8U, CV_16U or CV_32S labels and a palette\n");
+        return (-1);
+    }
+
+    // a full table for narrow labels, so a label outside the palette reads a zero color instead of past the end
+    std::vector<uint32_t> packed(depth == CV_32S ? palette.size() : depth == CV_16U ? 65536 : 256, 0);
+    for (size_t k = 0; k < palette.size() && k < packed.size(); k++)
+    {
+        packed[k] = palette[k][0] | (palette[k][1] << 8) | (palette[k][2] << 16);
+    }
+
+    dst.create(labels.rows, labels.cols, CV_8UC3);
+    cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++)
+        {
+            if (depth == CV_8U)
+            {
+                writeLabelRow(labels.ptr<uchar>(i), packed.data(), dst.ptr<uchar>(i), labels.cols);
+            }
+            else if (depth == CV_16U)
+            {
+                writeLabelRow(labels.ptr<ushort>(i), packed.data(), dst.ptr<uchar>(i), labels.cols);
+            }
+            else
+            {
+                writeLabelRow(labels.ptr<int>(i), packed.data(), dst.ptr<uchar>(i), labels.cols);
+            }
+        }
+    });
+
+    return (0);
+}
+
+/*
+  kmeansRestarts for labels of type L, int, uchar or ushort
+ */
+template <typename L>
+static int restartsRun(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, L *labels, int K, int restarts,
+                       int maxIterations, int stopThresh, int seeding, uint64 seed, double cancelSlack,
+                       KmeansStats *stats, bool verbose)
+{
+    // error checking
+    if (K > data.size() || restarts < 1)
+    {
+        printf("error: K must be less than the number of data points and restarts at least 1\n");
+        return (-1);
+    }
+
+    const int assignment = chooseAssignment(K);
+
+    // the runs publish the cancellation threshold of the best finished run, and the best run so far under the lock
+    std::atomic<double> cancelAbove(DBL_MAX);
+    std::mutex lock;
+    int best = -1;
+    double bestInertia = DBL_MAX;
+    KmeansStats bestStats;
+    cv::parallel_for_(cv::Range(0, restarts), [&](const cv::Range &range) {
+        std::vector<L> runLabels(data.size());
+        for (int r = range.start; r < range.end; r++)
+        {
+            cv::RNG rng(seed + (uint64)r * 0x9E3779B97F4A7C15ULL);
+            std::vector<cv::Vec3b> runMeans;
+            KmeansStats runStats;
+            if (kmeansSeed(data, runMeans, K, seeding, rng) != 0 ||
+                lloyd(data, NULL, runMeans, runLabels.data(), maxIterations, stopThresh, assignment, &runStats, -1,
+                      false, cancelSlack >= 0 ? &cancelAbove : NULL, false) != 0)
+            {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (runStats.inertia < bestInertia || (runStats.inertia == bestInertia && r < best))
+            {
+                best = r;
+                bestInertia = runStats.inertia;
+                bestStats = runStats;
+                means = runMeans;
+                std::copy(runLabels.begin(), runLabels.end(), labels);
+                if (cancelSlack >= 0)
+                {
+                    cancelAbove.store(bestInertia * (1 + cancelSlack));
+                }
+            }
+        }
+    }, restarts);
+
+    if (best < 0)
+    {
+        printf("error: every restart failed\n");
+        return (-1);
+    }
+    if (verbose)
+    {
+        printf("Best of %d restarts: %d, %d iterations, inertia: %.0f\n", restarts, best, bestStats.iterations,
+               bestInertia);
+    }
+    if (stats != NULL)
+    {
+        *stats = bestStats;
+    }
+
+    return (0);
+}
+
+/*
+  data: a std::vector of pixels
+  means: a std:vector of means, will contain the cluster means of the best restart when the function returns
+  labels: an allocated array of type int, the same size as the data, contains the labels of the best restart. The
+          cv::Mat overload stores narrower labels instead
+  K: the number of clusters
+  restarts: the number of independent runs, default is KMEANS_RESTARTS
+  maxIterations: maximum number of E-M interactions of each run, default is 10
+  stopThresh: if the means change less than the threshold, the E-M loop of a run terminates, default is 0
+  seeding: KMEANS_SEED_COMB, KMEANS_SEED_PLUSPLUS (default) or KMEANS_SEED_PARALLEL
+  seed: seed of the random number generator, restart r uses its own stream derived from seed and r, and restart 0 is
+        the same run as kmeans with this seed
+  cancelSlack: a run is cancelled once its inertia is more than 1 + cancelSlack times the best finished run after
+               KMEANS_RESTART_GRACE iterations, default is KMEANS_RESTART_SLACK, negative to run every restart to the
+               end
+  stats: if not NULL, receives the number of iterations and the final inertia of the best run
+  verbose: if true (default), prints the best run once every restart finished. The runs themselves never print, their
+           iterations interleave across threads
+
+  Executes K-means clustering several times from different seeds and keeps the run with the lowest inertia. The runs
+  execute concurrently, one per thread, and share the data. Each run keeps its own labels. Without cancellation the
+  result does not depend on the number of threads. With it, a run only stops early when it is clearly worse than a
+  finished one, so the result is the same unless such a run would have won.
+ */
+int kmeansRestarts(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int *labels, int K, int restarts,
+                   int maxIterations, int stopThresh, int seeding, uint64 seed, double cancelSlack,
+                   KmeansStats *stats, bool verbose)
+{
+    return restartsRun(data, means, labels, K, restarts, maxIterations, stopThresh, seeding, seed, cancelSlack, stats,
+                       verbose);
+}
+
+/*
+  labels: the labels, kept if it already has one element per data point of depth kmeansLabelDepth(K), otherwise
+          created as a column
+  the other parameters are the same as for kmeansRestarts with an int array of labels
+
+  Executes multi-restart K-means clustering with labels of 1 or 2 bytes for K up to 256 or 65536 instead of 4
+ */
+int kmeansRestarts(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, cv::Mat &labels, int K, int restarts,
+                   int maxIterations, int stopThresh, int seeding, uint64 seed, double cancelSlack,
+                   KmeansStats *stats, bool verbose)
+{
+    int depth = kmeansLabelDepth(K);
+    if (labels.total() != data.size() || labels.type() != depth || !labels.isContinuous())
+    {
+        labels.create((int)data.size(), 1, depth);
+    }
+
+    if (depth == CV_8U)
+    {
+        return restartsRun(data, means, labels.ptr<uchar>(), K, restarts, maxIterations, stopThresh, seeding, seed,
+                           cancelSlack, stats, verbose);
+    }
+    if (depth == CV_16U)
+    {
+        return restartsRun(data, means, labels.ptr<ushort>(), K, restarts, maxIterations, stopThresh, seeding, seed,
+                           cancelSlack, stats, verbose);
+    }
+    return restartsRun(data, means, labels.ptr<int>(), K, restarts, maxIterations, stopThresh, seeding, seed,
+                       cancelSlack, stats, verbose);
+}
+
+/*
+  image: a CV_8UC3 image
+  means: a std:vector of means, will contain the cluster means when the function returns
+  K: the number of clusters
+  bits: the number of bits kept per channel, the histogram has 2^(3 * bits) cells, default is 5
+  maxIterations: maximum number of E-M interactions, default is 10
+  stopThresh: if the means change less than the threshold, the E-M loop terminates, default is 0
+  seed: seed of the random number generator, the same seed gives the same result
+  stats: if not NULL, receives the number of iterations and the inertia of the cell colors weighted by their counts
+  verbose: if false, only errors are printed. Default is true
+
+  Executes K-means clustering on the colors of an image without a pass over the pixels per iteration. The pixels are
+  counted in a color cube and every occupied cell becomes one data point, the mean color of its pixels weighted by
+  their number. The seeds are picked with weighted k-means++ and the E-M iterations run over the occupied cells only,
+  typically a few thousand instead of millions of pixels. If fewer than K cells are occupied, means contains the color
+  of each cell.
+ */
+int kmeansHistogram(const cv::Mat &image, std::vector<cv::Vec3b> &means, int K, int bits, int maxIterations,
+                    int stopThresh, uint64 seed, KmeansStats *stats, bool verbose)
+{
+    if (image.empty() || image.type() != CV_8UC3)
+    {
+        printf("error: kmeansHistogram needs a CV_8UC3 image\n");
+        return (-1);
+    }
+    if (bits < 1 || bits > QUANTIZE_HISTOGRAM_MAX_BITS || K < 1)
+    {
+        printf("error: bits must be in [1, %d] and K at least 1\n", QUANTIZE_HISTOGRAM_MAX_BITS);
+        return (-1);
+    }
+
+    // every occupied cell of the color cube becomes a data point weighted by its count
+    std::vector<cv::Vec3b> colors;
+    std::vector<int> weights;
+    if (colorHistogram(image, colors, weights, bits) != 0)
+    {
+        return (-1);
+    }
+    if (verbose)
+    {
+        printf("Histogram: %d of %d cells occupied\n", (int)colors.size(), 1 << (3 * bits));
+    }
+
+    if ((int)colors.size() <= K)
+    {
+        means = colors;
+        if (stats != NULL)
+        {
+            stats->iterations = 0;
+            stats->inertia = 0;
+        }
+        return (0);
+    }
+
+    // weighted k-means++, the first seed is drawn with probability proportional to the count of its cell
+    cv::RNG rng(seed);
+    double target = rng.uniform(0.0, (double)image.total());
+    double cumulative = 0;
+    size_t first;
+    for (first = 0; first < colors.size() - 1; first++)
+    {
+        cumulative += weights[first];
+        if (cumulative > target)
         {
-            data.push_back(image.at<cv::Vec3b>(i, j));
+            break;
         }
     }
+    means.clear();
+    means.push_back(colors[first]);
+    std::vector<int> dist(colors.size(), INT_MAX);
+    kmeansUpdateSeedDistances(ColorMetric(), colors, dist, means, 0);
+    kmeansSeedPlusPlus(ColorMetric(), colors, &weights, dist, means, K, rng);
+
+    std::vector<int> labels(colors.size());
+    lloyd(colors, &weights, means, labels.data(), maxIterations, stopThresh, KMEANS_ASSIGN_AUTO, stats, -1, false, NULL,
+          verbose);
 
-    try
+    return (0);
+}
+
+/*
+  frame: a CV_8UC3 video frame
+  state: the means and labels of the previous frame, updated for this frame
+  K: the number of clusters
+  step: every step-th pixel of every step-th row is clustered, default is 1 for every pixel
+  maxIterations: maximum number of E-M interactions, default is 10
+  changeThresh: the E-M loop terminates once at most this fraction of the labels change in an iteration, default is 0.01
+  seed: seed of the random number generator, used when the state has to be seeded
+  stats: if not NULL, receives the number of iterations and the inertia of the sampled pixels
+
+  Executes K-means clustering on one frame of a video, starting from the means of the previous frame. Consecutive frames
+  have nearly the same colors, so the previous means and labels are already close to converged and the loop typically
+  stops after one iteration. The first frame, or a frame after K or the sampling changed, is seeded with k-means++.
+ */
+int kmeansVideoFrame(const cv::Mat &frame, KmeansVideo &state, int K, int step, int maxIterations,
+                     double changeThresh, uint64 seed, KmeansStats *stats)
+{
+    if (frame.empty() || frame.type() != CV_8UC3)
     {
-        int data_size = data.size();
-        printf("Data size: %d\n", data_size);
-        printf("Valid K: %d\n", (data_size % K));
+        printf("error: kmeansVideoFrame needs a CV_8UC3 frame\n");
+        return (-1);
     }
-    catch (const std::exception &e)
+    if (step < 1 || K < 1)
     {
-        std::cerr << e.what() << '\n';
+        printf("error: step and K must be at least 1\n");
+        return (-1);
     }
 
-    int maxIterations = 10;
-    int stopThresh = 0;
-    printf("\n=============================\n\n");
-    printf("Running kmeans ...\n");
-    kmeans(data, means, labels, K, maxIterations, stopThresh);
+    // sample the frame into the reused buffer
+    int rows = (frame.rows + step - 1) / step;
+    int cols = (frame.cols + step - 1) / step;
+    state.data.resize((size_t)rows * cols);
+    for (int i = 0; i < rows; i++)
+    {
+        const cv::Vec3b *src = frame.ptr<cv::Vec3b>(i * step);
+        cv::Vec3b *dst = &state.data[(size_t)i * cols];
+        for (int j = 0; j < cols; j++)
+        {
+            dst[j] = src[j * step];
+        }
+    }
+    if ((size_t)K > state.data.size())
+    {
+        printf("error: K must be less than the number of data points\n");
+        return (-1);
+    }
 
-    printf("Updating image with kmeans ...\n");
-    for (int i = 0; i < image.rows; i++)
+    // warm start from the previous frame when it was clustered the same way
+    bool warm = state.means.size() == (size_t)K && state.labels.size() == state.data.size();
+    if (!warm)
     {
-        for (int j = 0; j < image.cols; j++)
+        cv::RNG rng(seed);
+        if (kmeansSeed(state.data, state.means, K, KMEANS_SEED_PLUSPLUS, rng) != 0)
         {
-            int idx = labels[i * image.cols + j];
-            image.at<cv::Vec3b>(i, j) = means[idx];
+            return (-1);
         }
+        state.labels.assign(state.data.size(), 0);
+    }
+
+    // quiet, the caller prints one line per frame
+    lloyd(state.data, NULL, state.means, state.labels.data(), maxIterations, 0, KMEANS_ASSIGN_AUTO, stats,
+          changeThresh, warm, NULL, false);
+
+    return (0);
+}
+
+/*
+  SSD for float centers, the SSD macro truncates its first argument to int
+ */
+template <typename T> static inline float ssdFloat(const cv::Vec3f &a, const T &b)
+{
+    float d0 = a[0] - b[0], d1 = a[1] - b[1], d2 = a[2] - b[2];
+    return d0 * d0 + d1 * d1 + d2 * d2;
+}
+
+/*
+  image: a CV_8UC3 image, pixels are sampled from it directly
+  means: a std:vector of means, will contain the cluster means when the function returns
+  K: the number of clusters
+  batchSize: the number of pixels sampled per iteration, default is 1024
+  maxIterations: maximum number of batches, default is 500
+  tolerance: the loop also terminates once the average squared movement of the means in a batch is below this, default
+             is 0, which leaves it to the inertia based convergence check
+  seeding: how the initial means are picked from the first sample, KMEANS_SEED_COMB, KMEANS_SEED_PLUSPLUS (default) or
+           KMEANS_SEED_PARALLEL
+  seed: seed of the random number generator, the same seed gives the same result
+  stats: if not NULL, receives the number of batches and an estimate of the inertia over the whole image
+  verbose: if false, only errors are printed. Default is true
+
+  Executes mini-batch K-means clustering on the pixels of an image. Each batch of randomly sampled pixels is assigned
+  to the closest means, and every mean moves towards its pixels with a learning rate of 1 / (number of pixels it has
+  been given so far). The loop terminates when a moving average of the batch inertia has not improved for
+  KMEANS_MINIBATCH_PATIENCE batches. Memory use is O(batchSize + K) and the run time depends on the number of batches,
+  not on the size of the image. No labels are produced, map the image with the returned means.
+ */
+int kmeansMiniBatch(const cv::Mat &image, std::vector<cv::Vec3b> &means, int K, int batchSize, int maxIterations,
+                    double tolerance, int seeding, uint64 seed, KmeansStats *stats, bool verbose)
+{
+    if (image.empty() || image.type() != CV_8UC3)
+    {
+        printf("error: image must be a non empty CV_8UC3 image\n");
+        return (-1);
+    }
+    if (K < 1 || K > image.rows * image.cols || batchSize < 1)
+    {
+        printf("error: K must be in [1, number of pixels] and batchSize positive\n");
+        return (-1);
+    }
+
+    cv::RNG rng(seed);
+    std::vector<cv::Vec3b> batch(std::max(batchSize, 10 * K));
+
+    // seed on a larger first sample
+    for (size_t j = 0; j < batch.size(); j++)
+    {
+        batch[j] = image.ptr<cv::Vec3b>(rng.uniform(0, image.rows))[rng.uniform(0, image.cols)];
+    }
+    if (kmeansSeed(batch, means, K, seeding, rng) != 0)
+    {
+        return (-1);
     }
+    batch.resize(batchSize);
 
-    printf("Presenting images ...\n");
+    std::vector<cv::Vec3f> centers(K);
+    for (int k = 0; k < K; k++)
+    {
+        centers[k] = cv::Vec3f(means[k][0], means[k][1], means[k][2]);
+    }
+    std::vector<int> counts(K, 0);
+    std::vector<int> labels(batchSize);
+
+    // exponentially weighted average of the per pixel batch inertia, used to detect convergence
+    double smoothed = -1, best = DBL_MAX;
+    int sinceBest = 0;
+    int iterations = 0;
+    bool converged = false;
+
+    for (int i = 0; i < maxIterations; i++)
+    {
+        iterations++;
+
+        for (int j = 0; j < batchSize; j++)
+        {
+            batch[j] = image.ptr<cv::Vec3b>(rng.uniform(0, image.rows))[rng.uniform(0, image.cols)];
+        }
+
+        // assign the batch to the current centers
+        double batchInertia = 0;
+        for (int j = 0; j < batchSize; j++)
+        {
+            float minssd = FLT_MAX;
+            int minidx = 0;
+            for (int k = 0; k < K; k++)
+            {
+                float tssd = ssdFloat(centers[k], batch[j]);
+                if (tssd < minssd)
+                {
+                    minssd = tssd;
+                    minidx = k;
+                }
+            }
+            labels[j] = minidx;
+            batchInertia += minssd;
+        }
+
+        // move each center towards its pixels, with a learning rate that decays as the center sees more pixels
+        std::vector<cv::Vec3f> previous(centers);
+        for (int j = 0; j < batchSize; j++)
+        {
+            int k = labels[j];
+            counts[k]++;
+            float rate = 1.0f / counts[k];
+            for (int c = 0; c < 3; c++)
+            {
+                centers[k][c] += rate * (batch[j][c] - centers[k][c]);
+            }
+        }
+
+        double moved = 0;
+        for (int k = 0; k < K; k++)
+        {
+            moved += ssdFloat(centers[k], previous[k]);
+        }
+        moved /= K;
+
+        batchInertia /= batchSize;
+        smoothed = smoothed < 0 ? batchInertia : 0.9 * smoothed + 0.1 * batchInertia;
+        if (smoothed < best)
+        {
+            best = smoothed;
+            sinceBest = 0;
+        }
+        else
+        {
+            sinceBest++;
+        }
+
+        // check if we can stop early
+        if (moved < tolerance || sinceBest >= KMEANS_MINIBATCH_PATIENCE)
+        {
+            converged = true;
+            break;
+        }
+    }
 
-    cv::imshow("Original", original);
-    cv::imshow("K-means", image);
-    cv::waitKey(0);
-    cv::imwrite(filename + std::to_string(K) + "_kmeans.jpg", image);
+    for (int k = 0; k < K; k++)
+    {
+        means[k] = cv::Vec3b(cv::saturate_cast<uchar>(centers[k][0]), cv::saturate_cast<uchar>(centers[k][1]),
+                             cv::saturate_cast<uchar>(centers[k][2]));
+    }
 
-    delete[] labels;
+    if (verbose)
+    {
+        printf("Mini-batch %s after %d batches, estimated inertia: %.0f\n", converged ? "converged" : "stopped",
+               iterations, smoothed * image.rows * image.cols);
+    }
+    if (stats != NULL)
+    {
+        stats->iterations = iterations;
+        stats->inertia = smoothed * image.rows * image.cols;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    return (0);
+}
@@ -18,12 +18,81 @@
 #include <cstring>
 #include <opencv2/opencv.hpp>
 
+#include "quantize.h"
+
 #ifndef KMEANS_H
 #define KMEANS_H
 
 #define SSD(a, b) (((int)a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]))
 
+// Seeding methods for kmeans
+#define KMEANS_SEED_COMB 0     // evenly spaced samples from a random offset
+#define KMEANS_SEED_PLUSPLUS 1 // k-means++: each seed drawn with probability proportional to its SSD to the nearest one
+#define KMEANS_SEED_PARALLEL 2 // k-means||: oversampled k-means++ rounds in parallel, reclustered down to K seeds
+
+// Assignment methods for kmeans, all give the same labels
+#define KMEANS_ASSIGN_AUTO 0    // naive for K = 1 or when it is vectorized, Hamerly otherwise
+#define KMEANS_ASSIGN_NAIVE 1   // SSD to every mean, vectorized with nearestColors
+#define KMEANS_ASSIGN_HAMERLY 2 // skips points whose label provably cannot change, 2 bounds per point
+#define KMEANS_ASSIGN_ELKAN 3   // skips individual means that provably cannot be closer, K + 1 bounds per point
+
+// Mini-batch kmeans stops when the smoothed batch inertia has not improved for this many batches
+#define KMEANS_MINIBATCH_PATIENCE 10
+
+// Multi-restart kmeans runs this many restarts by default. A restart is cancelled once, after the grace iterations,
+// its inertia is more than 1 + slack times that of the best finished restart.
+#define KMEANS_RESTARTS 8
+#define KMEANS_RESTART_GRACE 3
+#define KMEANS_RESTART_SLACK 0.25
+
+// Statistics of a kmeans run
+struct KmeansStats
+{
+    int iterations; // number of E-M iterations run
+    double inertia; // sum of the SSD of every data point to its assigned mean
+};
+
 int kmeans(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int *labels, int K, int maxIterations = 10,
-           int stopThresh = 0);
+           int stopThresh = 0, int seeding = KMEANS_SEED_COMB, uint64 seed = 0, int assignment = KMEANS_ASSIGN_AUTO,
+           KmeansStats *stats = NULL, bool verbose = true);
+
+int kmeans(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, cv::Mat &labels, int K, int maxIterations = 10,
+           int stopThresh = 0, int seeding = KMEANS_SEED_COMB, uint64 seed = 0, int assignment = KMEANS_ASSIGN_AUTO,
+           KmeansStats *stats = NULL, bool verbose = true);
+
+int kmeansLabelDepth(int K);
+
+int writeLabelColors(const cv::Mat &labels, const std::vector<cv::Vec3b> &palette, cv::Mat &dst);
+
+int kmeansRestarts(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int *labels, int K,
+                   int restarts = KMEANS_RESTARTS, int maxIterations = 10, int stopThresh = 0,
+                   int seeding = KMEANS_SEED_PLUSPLUS, uint64 seed = 0, double cancelSlack = KMEANS_RESTART_SLACK,
+                   KmeansStats *stats = NULL, bool verbose = true);
+
+int kmeansRestarts(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, cv::Mat &labels, int K,
+                   int restarts = KMEANS_RESTARTS, int maxIterations = 10, int stopThresh = 0,
+                   int seeding = KMEANS_SEED_PLUSPLUS, uint64 seed = 0, double cancelSlack = KMEANS_RESTART_SLACK,
+                   KmeansStats *stats = NULL, bool verbose = true);
+
+int kmeansHistogram(const cv::Mat &image, std::vector<cv::Vec3b> &means, int K, int bits = QUANTIZE_HISTOGRAM_BITS,
+                    int maxIterations = 10, int stopThresh = 0, uint64 seed = 0, KmeansStats *stats = NULL,
+                    bool verbose = true);
+
+// State carried by kmeansVideoFrame from one frame to the next
+struct KmeansVideo
+{
+    std::vector<cv::Vec3b> means; // the palette of the last frame
+    std::vector<int> labels;      // the labels of the sampled pixels of the last frame
+    std::vector<cv::Vec3b> data;  // the sampled pixels, reused across frames
+};
+
+int kmeansVideoFrame(const cv::Mat &frame, KmeansVideo &state, int K, int step = 1, int maxIterations = 10,
+                     double changeThresh = 0.01, uint64 seed = 0, KmeansStats *stats = NULL);
+
+int kmeansMiniBatch(const cv::Mat &image, std::vector<cv::Vec3b> &means, int K, int batchSize = 1024,
+                    int maxIterations = 500, double tolerance = 0, int seeding = KMEANS_SEED_PLUSPLUS, uint64 seed = 0,
+                    KmeansStats *stats = NULL, bool verbose = true);
+
+int kmeansSeed(std::vector<cv::Vec3b> &data, std::vector<cv::Vec3b> &means, int K, int seeding, cv::RNG &rng);
 
 #endif
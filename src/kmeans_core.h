@@ -0,0 +1,480 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: The seeding and bounded assignment steps of K-means, shared by the color engine in kmeans.cpp and the
+// N-dimensional engine in kmeans_nd.h. Both are templated on a metric that supplies the points, the seeds and the
+// distance, so each engine keeps its own distance type: the integer SSD for colors and a floating point squared
+// distance for vectors.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "kmeans.h"
+
+#ifndef KMEANS_CORE_H
+#define KMEANS_CORE_H
+
+// Oversampling factor of k-means||, as a multiple of K, and the number of sampling rounds
+#define KMEANS_PARALLEL_OVERSAMPLE 2
+#define KMEANS_PARALLEL_ROUNDS 5
+
+/*
+  A metric is a struct with:
+
+  Dist: the type of a squared distance
+  Points: the data points
+  Seeds: a set of centers, the seeds while seeding and the means afterwards
+  CandidateView: the type of candidates(), readable as points by the functions below
+  BLOCK: data points per block of the parallel loops. Every block of k-means|| draws from its own RNG seeded from the
+         block index, so the sampled seeds do not depend on the number of threads.
+
+  rows(points): the number of points, for Points and CandidateView
+  seedCount(seeds): the number of seeds
+  distance(points, j, seeds, s): the squared distance between point j and seed s
+  centerDistance(seeds, a, b): the squared distance between seeds a and b
+  addSeed(points, j, seeds): append point j to the seeds
+  candidates(seeds): view the seeds as points
+  upperBound(d), lowerBound(d): the distance for a squared distance d, widened up or down by its rounding error
+  halfBound(d): a lower bound on half the distance for a squared distance d
+  shiftSlack(): added to every shift of a center before it is applied to a bound
+ */
+
+/*
+  value: a lower bound
+
+  Converts a lower bound to float, rounding down so it stays a lower bound
+ */
+static inline float kmeansLowerToFloat(double value)
+{
+    float f = (float)value;
+    return f > value ? std::nextafter(f, -FLT_MAX) : f;
+}
+
+/*
+  metric: the metric
+  points: the points
+  dist: the squared distance of each point to its closest seed so far, updated in parallel
+  seeds: the seeds
+  first: the index of the first seed not yet accounted for in dist
+
+  Lowers dist to account for seeds[first..]
+ */
+template <typename Metric, typename P>
+void kmeansUpdateSeedDistances(const Metric &metric, const P &points, std::vector<typename Metric::Dist> &dist,
+                               const typename Metric::Seeds &seeds, size_t first)
+{
+    typedef typename Metric::Dist Dist;
+    const size_t n = metric.rows(points);
+    const size_t count = metric.seedCount(seeds);
+    int blocks = (int)((n + Metric::BLOCK - 1) / Metric::BLOCK);
+    cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range &range) {
+        size_t end = std::min(n, (size_t)range.end * Metric::BLOCK);
+        for (size_t j = (size_t)range.start * Metric::BLOCK; j < end; j++)
+        {
+            Dist d = dist[j];
+            for (size_t s = first; s < count; s++)
+            {
+                Dist t = metric.distance(points, j, seeds, s);
+                d = t < d ? t : d;
+            }
+            dist[j] = d;
+        }
+    });
+}
+
+/*
+  metric: the metric
+  points: the points
+  weights: the weight of each point, or NULL for all ones
+  dist: the squared distance of each point to its closest seed so far
+  seeds: the seeds, the new ones are appended
+  count: the number of seeds wanted
+  rng: the random number generator
+
+  Adds k-means++ seeds until there are count: each new seed is drawn with probability proportional to its weighted
+  squared distance to the closest existing seed, and dist is updated with the new seed
+ */
+template <typename Metric, typename P>
+void kmeansSeedPlusPlus(const Metric &metric, const P &points, const std::vector<int> *weights,
+                        std::vector<typename Metric::Dist> &dist, typename Metric::Seeds &seeds, int count,
+                        cv::RNG &rng)
+{
+    const size_t n = metric.rows(points);
+    while ((int)metric.seedCount(seeds) < count)
+    {
+        double total = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            total += (double)dist[j] * (weights ? (*weights)[j] : 1);
+        }
+
+        // every point is already a seed, so any choice is a duplicate
+        size_t pick = rng.uniform(0, (int)n);
+        if (total > 0)
+        {
+            double target = rng.uniform(0.0, total);
+            double cumulative = 0;
+            for (pick = 0; pick < n - 1; pick++)
+            {
+                cumulative += (double)dist[pick] * (weights ? (*weights)[pick] : 1);
+                if (cumulative > target)
+                {
+                    break;
+                }
+            }
+        }
+
+        size_t first = metric.seedCount(seeds);
+        metric.addSeed(points, pick, seeds);
+        kmeansUpdateSeedDistances(metric, points, dist, seeds, first);
+    }
+}
+
+/*
+  metric: the metric
+  data: the data points
+  means: receives the K seeds
+  K: the number of clusters, in [1, number of data points]
+  seeding: KMEANS_SEED_COMB, KMEANS_SEED_PLUSPLUS or KMEANS_SEED_PARALLEL
+  rng: the random number generator, the seeds only depend on its state
+
+  Picks the K initial means
+ */
+template <typename Metric>
+void kmeansSeedCenters(const Metric &metric, const typename Metric::Points &data, typename Metric::Seeds &means,
+                       int K, int seeding, cv::RNG &rng)
+{
+    typedef typename Metric::Dist Dist;
+    const size_t n = metric.rows(data);
+
+    means.clear();
+    if (seeding == KMEANS_SEED_COMB)
+    {
+        // evenly spaced points from a random offset. We need to account for the case where n % K is 0.
+        size_t delta = n / K;
+        int offsets = n % K > 0 ? (int)(n % K) : 1;
+        size_t start = rng.uniform(0, offsets);
+        for (int k = 0; k < K; k++)
+        {
+            metric.addSeed(data, (start + k * delta) % n, means);
+        }
+        return;
+    }
+
+    // both methods start from a single uniformly chosen seed
+    std::vector<Dist> dist(n, std::numeric_limits<Dist>::max());
+    metric.addSeed(data, rng.uniform(0, (int)n), means);
+    kmeansUpdateSeedDistances(metric, data, dist, means, 0);
+
+    if (seeding == KMEANS_SEED_PLUSPLUS)
+    {
+        kmeansSeedPlusPlus(metric, data, NULL, dist, means, K, rng);
+        return;
+    }
+
+    // k-means||: a few rounds that each sample about oversample points independently with probability proportional to
+    // their squared distance, instead of K sequential passes over the data
+    typename Metric::Seeds candidates = means;
+    const double oversample = (double)KMEANS_PARALLEL_OVERSAMPLE * K;
+    const uint64 roundSeed = rng.next();
+    const int blocks = (int)((n + Metric::BLOCK - 1) / Metric::BLOCK);
+    for (int round = 0; round < KMEANS_PARALLEL_ROUNDS; round++)
+    {
+        double total = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            total += dist[j];
+        }
+        if (total <= 0)
+        {
+            break;
+        }
+
+        std::vector<std::vector<size_t> > sampled(blocks);
+        cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range &range) {
+            for (int b = range.start; b < range.end; b++)
+            {
+                cv::RNG blockRng(roundSeed + (uint64)round * blocks + b + 1);
+                size_t end = std::min(n, (size_t)(b + 1) * Metric::BLOCK);
+                for (size_t j = (size_t)b * Metric::BLOCK; j < end; j++)
+                {
+                    if (blockRng.uniform(0.0, 1.0) < oversample * dist[j] / total)
+                    {
+                        sampled[b].push_back(j);
+                    }
+                }
+            }
+        });
+
+        size_t first = metric.seedCount(candidates);
+        for (int b = 0; b < blocks; b++)
+        {
+            for (size_t j : sampled[b])
+            {
+                metric.addSeed(data, j, candidates);
+            }
+        }
+        kmeansUpdateSeedDistances(metric, data, dist, candidates, first);
+    }
+
+    // weight each candidate by the number of points closest to it
+    const size_t count = metric.seedCount(candidates);
+    std::vector<int> closest(n);
+    cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range &range) {
+        size_t end = std::min(n, (size_t)range.end * Metric::BLOCK);
+        for (size_t j = (size_t)range.start * Metric::BLOCK; j < end; j++)
+        {
+            Dist best = metric.distance(data, j, candidates, 0);
+            int index = 0;
+            for (size_t c = 1; c < count; c++)
+            {
+                Dist d = metric.distance(data, j, candidates, c);
+                if (d < best)
+                {
+                    best = d;
+                    index = c;
+                }
+            }
+            closest[j] = index;
+        }
+    });
+    std::vector<int> weights(count, 0);
+    for (size_t j = 0; j < n; j++)
+    {
+        weights[closest[j]]++;
+    }
+
+    // recluster the weighted candidates down to K seeds with k-means++
+    typename Metric::CandidateView view = metric.candidates(candidates);
+    means.clear();
+    metric.addSeed(view, rng.uniform(0, (int)count), means);
+    std::vector<Dist> candidateDist(count, std::numeric_limits<Dist>::max());
+    kmeansUpdateSeedDistances(metric, view, candidateDist, means, 0);
+    kmeansSeedPlusPlus(metric, view, &weights, candidateDist, means, std::min(K, (int)count), rng);
+
+    // too few candidates were sampled, top up from the full data
+    if ((int)metric.seedCount(means) < K)
+    {
+        std::fill(dist.begin(), dist.end(), std::numeric_limits<Dist>::max());
+        kmeansUpdateSeedDistances(metric, data, dist, means, 0);
+        kmeansSeedPlusPlus(metric, data, NULL, dist, means, K, rng);
+    }
+}
+
+/*
+  metric: the metric
+  means: the current means
+  K: the number of means
+  half: receives half the distance between every pair of means, K x K
+  halfMin: receives half the distance from each mean to its closest other mean
+
+  Computes the inter-centre distances used by the Hamerly and Elkan tests
+ */
+template <typename Metric>
+void kmeansHalfCenterDistances(const Metric &metric, const typename Metric::Seeds &means, int K,
+                               std::vector<double> &half, std::vector<double> &halfMin)
+{
+    half.assign((size_t)K * K, 0);
+    halfMin.assign(K, DBL_MAX);
+    cv::parallel_for_(cv::Range(0, K), [&](const cv::Range &range) {
+        for (int a = range.start; a < range.end; a++)
+        {
+            for (int b = 0; b < K; b++)
+            {
+                if (b != a)
+                {
+                    double d = metric.halfBound(metric.centerDistance(means, a, b));
+                    half[(size_t)a * K + b] = d;
+                    halfMin[a] = std::min(halfMin[a], d);
+                }
+            }
+        }
+    });
+}
+
+/*
+  metric: the metric
+  data: the data points
+  means: the current means
+  K: the number of means
+  labels: the labels from the previous call, updated
+  upper: per point upper bound on the distance to its mean
+  lower: per point lower bound on the distance to its second closest mean
+  shift: how far each mean moved since the previous call
+  halfMin: the inter-centre distances of the current means from kmeansHalfCenterDistances
+  begin, end: the range of points to assign
+  first: true on the first call, when there are no bounds yet
+
+  Hamerly's assignment: a point is skipped when its upper bound is below both its lower bound and half the distance from
+  its mean to the closest other mean, since then no other mean can be closer. Only two bounds are kept per point.
+ */
+template <typename Metric, typename L>
+void kmeansAssignHamerly(const Metric &metric, const typename Metric::Points &data,
+                         const typename Metric::Seeds &means, int K, L *labels, std::vector<double> &upper,
+                         std::vector<double> &lower, const std::vector<double> &shift,
+                         const std::vector<double> &halfMin, size_t begin, size_t end, bool first)
+{
+    typedef typename Metric::Dist Dist;
+
+    // the lower bound drops by the largest shift of any other mean
+    int maxIdx = 0;
+    double maxShift = 0, secondShift = 0;
+    for (int k = 0; k < K; k++)
+    {
+        if (shift[k] > maxShift)
+        {
+            secondShift = maxShift;
+            maxShift = shift[k];
+            maxIdx = k;
+        }
+        else if (shift[k] > secondShift)
+        {
+            secondShift = shift[k];
+        }
+    }
+
+    for (size_t j = begin; j < end; j++)
+    {
+        if (!first)
+        {
+            int a = labels[j];
+            upper[j] += shift[a] + metric.shiftSlack();
+            lower[j] -= (a == maxIdx ? secondShift : maxShift) + metric.shiftSlack();
+
+            double bound = std::max(halfMin[a], lower[j]);
+            if (upper[j] < bound)
+            {
+                continue;
+            }
+
+            // tighten the upper bound and try again
+            upper[j] = metric.upperBound(metric.distance(data, j, means, a));
+            if (upper[j] < bound)
+            {
+                continue;
+            }
+        }
+
+        // full search, keeping the closest and second closest
+        Dist best = metric.distance(data, j, means, 0);
+        Dist second = std::numeric_limits<Dist>::max();
+        int index = 0;
+        for (int k = 1; k < K; k++)
+        {
+            Dist d = metric.distance(data, j, means, k);
+            if (d < best)
+            {
+                second = best;
+                best = d;
+                index = k;
+            }
+            else if (d < second)
+            {
+                second = d;
+            }
+        }
+        labels[j] = (L)index;
+        upper[j] = metric.upperBound(best);
+        lower[j] = K > 1 ? metric.lowerBound(second) : DBL_MAX;
+    }
+}
+
+/*
+  metric: the metric
+  data: the data points
+  means: the current means
+  K: the number of means
+  labels: the labels from the previous call, updated
+  upper: per point upper bound on the distance to its mean
+  lower: per point lower bounds on the distance to every mean, N x K, stored with the drift of the mean added
+  shift: how far each mean moved since the previous call
+  drift: how far each mean moved in total
+  half, halfMin: the inter-centre distances of the current means from kmeansHalfCenterDistances
+  begin, end: the range of points to assign
+  first: true on the first call, when there are no bounds yet
+
+  Elkan's assignment: one lower bound per point and mean, so each mean is skipped individually when the upper bound is
+  below its lower bound or below half its distance to the current mean. The lower bounds are stored relative to the
+  total drift of their mean, so moving the means does not require a pass over all N x K bounds.
+ */
+template <typename Metric, typename L>
+void kmeansAssignElkan(const Metric &metric, const typename Metric::Points &data, const typename Metric::Seeds &means,
+                       int K, L *labels, std::vector<double> &upper, std::vector<float> &lower,
+                       const std::vector<double> &shift, const std::vector<double> &drift,
+                       const std::vector<double> &half, const std::vector<double> &halfMin, size_t begin, size_t end,
+                       bool first)
+{
+    typedef typename Metric::Dist Dist;
+
+    if (first)
+    {
+        for (size_t j = begin; j < end; j++)
+        {
+            float *lowerJ = &lower[j * K];
+            Dist best = std::numeric_limits<Dist>::max();
+            int index = 0;
+            for (int k = 0; k < K; k++)
+            {
+                Dist d = metric.distance(data, j, means, k);
+                lowerJ[k] = kmeansLowerToFloat(metric.lowerBound(d) + drift[k]);
+                if (d < best)
+                {
+                    best = d;
+                    index = k;
+                }
+            }
+            labels[j] = (L)index;
+            upper[j] = metric.upperBound(best);
+        }
+        return;
+    }
+
+    for (size_t j = begin; j < end; j++)
+    {
+        float *lowerJ = &lower[j * K];
+        int a = labels[j];
+        upper[j] += shift[a] + metric.shiftSlack();
+        if (upper[j] < halfMin[a])
+        {
+            continue;
+        }
+
+        // means are visited in order and ties go to the lower index, as in the full search
+        bool tight = false;
+        Dist ad = 0;
+        for (int k = 0; k < K; k++)
+        {
+            if (k == a || upper[j] < lowerJ[k] - drift[k] || upper[j] < half[(size_t)a * K + k])
+            {
+                continue;
+            }
+            if (!tight)
+            {
+                ad = metric.distance(data, j, means, a);
+                upper[j] = metric.upperBound(ad);
+                lowerJ[a] = kmeansLowerToFloat(metric.lowerBound(ad) + drift[a]);
+                tight = true;
+                if (upper[j] < lowerJ[k] - drift[k] || upper[j] < half[(size_t)a * K + k])
+                {
+                    continue;
+                }
+            }
+
+            Dist d = metric.distance(data, j, means, k);
+            lowerJ[k] = kmeansLowerToFloat(metric.lowerBound(d) + drift[k]);
+            if (d < ad || (d == ad && k < a))
+            {
+                a = k;
+                ad = d;
+                upper[j] = metric.upperBound(d);
+            }
+        }
+        labels[j] = (L)a;
+    }
+}
+
+#endif
@@ -0,0 +1,85 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Dispatch of K-means on a cv::Mat to the engine compiled for its element type and dimension.
+
+#include <cstdio>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "kmeans_nd.h"
+
+/**
+ * @brief Run the engine for element type T, picking a compiled dimension when there is one for the data.
+ */
+template <typename T>
+static int kmeansDispatch(const cv::Mat &data, cv::Mat &centers, int *labels, int K, int maxIterations,
+                          double stopThresh, int seeding, uint64 seed, int assignment, KmeansStats *stats)
+{
+    MatrixView<T> view(data.ptr<T>(0), data.rows, data.cols, data.step1());
+    switch (data.cols)
+    {
+    case 2:
+        return kmeansND<T, 2>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 3:
+        return kmeansND<T, 3>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 4:
+        return kmeansND<T, 4>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 8:
+        return kmeansND<T, 8>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 16:
+        return kmeansND<T, 16>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 32:
+        return kmeansND<T, 32>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 64:
+        return kmeansND<T, 64>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 128:
+        return kmeansND<T, 128>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    case 512:
+        return kmeansND<T, 512>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    default:
+        return kmeansND<T, 0>(view, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment, stats);
+    }
+}
+
+/**
+ * @brief Cluster the rows of a CV_8U, CV_32F or CV_64F single channel matrix with K-means.
+ *
+ * Common dimensions use an engine compiled for that dimension, any other uses the run time dimension one.
+ *
+ * @param data The data points, one per row.
+ * @param centers Receives the K x cols centers, CV_32F or CV_64F for CV_64F data.
+ * @param labels An allocated array with one entry per row, receives the index of its center.
+ * @param K The number of clusters.
+ * @param maxIterations Maximum number of E-M iterations.
+ * @param stopThresh The loop terminates when the sum of the squared movements of the centers is at most this.
+ * @param seeding KMEANS_SEED_COMB, KMEANS_SEED_PLUSPLUS or KMEANS_SEED_PARALLEL.
+ * @param seed Seed of the random number generator, the same seed gives the same result.
+ * @param assignment KMEANS_ASSIGN_AUTO, KMEANS_ASSIGN_NAIVE, KMEANS_ASSIGN_HAMERLY or KMEANS_ASSIGN_ELKAN.
+ * @param stats If not NULL, receives the number of iterations and the final inertia.
+ * @return 0 if successful, -1 if error.
+ */
+int kmeansMat(const cv::Mat &data, cv::Mat &centers, int *labels, int K, int maxIterations, double stopThresh,
+              int seeding, uint64 seed, int assignment, KmeansStats *stats)
+{
+    if (data.empty() || data.channels() != 1)
+    {
+        printf("error: kmeansMat needs a single channel matrix with one data point per row\n");
+        return -1;
+    }
+
+    switch (data.depth())
+    {
+    case CV_8U:
+        return kmeansDispatch<uchar>(data, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment,
+                                     stats);
+    case CV_32F:
+        return kmeansDispatch<float>(data, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment,
+                                     stats);
+    case CV_64F:
+        return kmeansDispatch<double>(data, centers, labels, K, maxIterations, stopThresh, seeding, seed, assignment,
+                                      stats);
+    default:
+        printf("error: kmeansMat supports CV_8U, CV_32F and CV_64F data\n");
+        return -1;
+    }
+}
@@ -0,0 +1,164 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Checks the N-dimensional K-means engine on synthetic clusters. Every assignment method, the compiled and the
+// run time dimension engines, and runs with one or all threads must give the same labels, centers and iterations.
+
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "kmeans_nd.h"
+
+/**
+ * @brief The result of one K-means run.
+ */
+struct NdRun
+{
+    int status;
+    cv::Mat centers;
+    std::vector<int> labels;
+    KmeansStats stats;
+};
+
+/**
+ * @brief Generate rows points around K random centers with Gaussian noise.
+ *
+ * @param rows The number of points.
+ * @param dims The number of columns.
+ * @param K The number of clusters.
+ * @param depth CV_8U, CV_32F or CV_64F.
+ * @param seed Seed of the random number generator.
+ * @return The rows x dims data.
+ */
+static cv::Mat makeBlobs(int rows, int dims, int K, int depth, uint64 seed)
+{
+    cv::RNG rng(seed);
+    cv::Mat centers(K, dims, CV_64F);
+    rng.fill(centers, cv::RNG::UNIFORM, 32, 224);
+
+    cv::Mat data(rows, dims, CV_64F);
+    for (int i = 0; i < rows; i++)
+    {
+        const double *center = centers.ptr<double>(rng.uniform(0, K));
+        double *ptr = data.ptr<double>(i);
+        for (int c = 0; c < dims; c++)
+        {
+            ptr[c] = center[c] + rng.gaussian(12);
+        }
+    }
+
+    cv::Mat converted;
+    data.convertTo(converted, depth);
+    return converted;
+}
+
+/**
+ * @brief Run kmeansMat, or the run time dimension engine when generic is true.
+ */
+static NdRun runOnce(const cv::Mat &data, int K, int seeding, int assignment, bool generic)
+{
+    NdRun run;
+    run.labels.resize(data.rows);
+    if (!generic)
+    {
+        run.status = kmeansMat(data, run.centers, run.labels.data(), K, 20, 0, seeding, 42, assignment, &run.stats);
+    }
+    else if (data.depth() == CV_8U)
+    {
+        MatrixView<uchar> view(data.ptr<uchar>(0), data.rows, data.cols, data.step1());
+        run.status = kmeansND<uchar, 0>(view, run.centers, run.labels.data(), K, 20, 0, seeding, 42, assignment,
+                                        &run.stats);
+    }
+    else if (data.depth() == CV_32F)
+    {
+        MatrixView<float> view(data.ptr<float>(0), data.rows, data.cols, data.step1());
+        run.status = kmeansND<float, 0>(view, run.centers, run.labels.data(), K, 20, 0, seeding, 42, assignment,
+                                        &run.stats);
+    }
+    else
+    {
+        MatrixView<double> view(data.ptr<double>(0), data.rows, data.cols, data.step1());
+        run.status = kmeansND<double, 0>(view, run.centers, run.labels.data(), K, 20, 0, seeding, 42, assignment,
+                                         &run.stats);
+    }
+    return run;
+}
+
+/**
+ * @brief Check that two runs gave exactly the same result, and print what differs if not.
+ */
+static bool sameRun(const NdRun &a, const NdRun &b, const char *what)
+{
+    bool same = a.status == 0 && b.status == 0 && a.labels == b.labels && a.stats.iterations == b.stats.iterations &&
+                a.centers.size() == b.centers.size() && a.centers.type() == b.centers.type() &&
+                cv::norm(a.centers, b.centers, cv::NORM_INF) == 0;
+    if (!same)
+    {
+        printf("  FAIL: %s\n", what);
+    }
+    return same;
+}
+
+/**
+ * @brief Main function to check the N-dimensional K-means engine
+ *
+ * @param argc The number of command line arguments
+ * @param argv The command line arguments
+ * @return int 0 if every check passed, 1 otherwise
+ */
+int main(int argc, char *argv[])
+{
+    int rows = argc > 1 ? atoi(argv[1]) : 20000;
+
+    printf("\n\n========== N-dimensional K-means check ==========\n\n");
+
+    const int depths[3] = {CV_8U, CV_32F, CV_64F};
+    const char *depthNames[3] = {"uchar", "float", "double"};
+    const int dims[4] = {3, 16, 40, 128}; // 40 has no compiled engine
+    const int Ks[3] = {1, 8, 64};
+    const int seedings[3] = {KMEANS_SEED_COMB, KMEANS_SEED_PLUSPLUS, KMEANS_SEED_PARALLEL};
+    const int assignments[3] = {KMEANS_ASSIGN_NAIVE, KMEANS_ASSIGN_HAMERLY, KMEANS_ASSIGN_ELKAN};
+    const int threads = cv::getNumThreads();
+
+    int checks = 0, failures = 0;
+    for (int t = 0; t < 3; t++)
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                cv::Mat data = makeBlobs(rows, dims[d], Ks[k], depths[t], 1000 + 10 * d + k);
+                for (int s = 0; s < 3; s++)
+                {
+                    printf("%-6s dims %3d K %3d seeding %d\n", depthNames[t], dims[d], Ks[k], seedings[s]);
+                    NdRun reference = runOnce(data, Ks[k], seedings[s], KMEANS_ASSIGN_NAIVE, false);
+
+                    for (int a = 1; a < 3; a++)
+                    {
+                        checks++;
+                        NdRun run = runOnce(data, Ks[k], seedings[s], assignments[a], false);
+                        failures += !sameRun(reference, run, a == 1 ? "Hamerly differs from naive"
+                                                                    : "Elkan differs from naive");
+                    }
+
+                    checks++;
+                    NdRun generic = runOnce(data, Ks[k], seedings[s], KMEANS_ASSIGN_NAIVE, true);
+                    failures += !sameRun(reference, generic, "run time dimension engine differs");
+
+                    checks++;
+                    cv::setNumThreads(1);
+                    NdRun single = runOnce(data, Ks[k], seedings[s], KMEANS_ASSIGN_AUTO, false);
+                    cv::setNumThreads(threads);
+                    failures += !sameRun(reference, single, "one thread differs from all threads");
+                }
+            }
+        }
+    }
+
+    printf("\n%d of %d checks passed\n", checks - failures, checks);
+    printf("Terminating\n\n");
+
+    return failures > 0 ? 1 : 0;
+}
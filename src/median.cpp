@@ -0,0 +1,220 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Constant time median filter (Perreault and Hebert) for denoising images.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "median.h"
+
+/**
+ * @brief Median filter one channel of the rows [y0, y1).
+ *
+ * Column histograms are kept for cols + 2 * radius padded columns so the kernel never has to clamp x.
+ *
+ * @param src The source image.
+ * @param dst The destination image.
+ * @param radius The kernel radius.
+ * @param c The channel.
+ * @param y0 The first row of the band.
+ * @param y1 One past the last row of the band.
+ * @param coarse Column coarse histograms, 16 bins per padded column.
+ * @param fine Column fine histograms, 256 bins per padded column.
+ */
+static void medianBandChannel(const cv::Mat &src, cv::Mat &dst, int radius, int c, int y0, int y1,
+                              std::vector<ushort> &coarse, std::vector<ushort> &fine)
+{
+    const int cn = src.channels();
+    const int padded = src.cols + 2 * radius;
+    const int diameter = 2 * radius + 1;
+    const int half = diameter * diameter / 2;
+    const int lastRow = src.rows - 1;
+
+    // Channel offset of every padded column, with the border replicated
+    std::vector<int> offsets(padded);
+    for (int x = 0; x < padded; x++)
+    {
+        offsets[x] = std::min(std::max(x - radius, 0), src.cols - 1) * cn + c;
+    }
+
+    // Column histograms for the first row of the band
+    std::fill(coarse.begin(), coarse.end(), 0);
+    std::fill(fine.begin(), fine.end(), 0);
+    for (int j = y0 - radius; j <= y0 + radius; j++)
+    {
+        const uchar *ptr = src.ptr<uchar>(std::min(std::max(j, 0), lastRow));
+        for (int x = 0; x < padded; x++)
+        {
+            uchar v = ptr[offsets[x]];
+            coarse[x * 16 + (v >> 4)]++;
+            fine[x * 256 + v]++;
+        }
+    }
+
+    ushort kernelCoarse[16];
+    ushort kernelFine[256];
+    int lastUpdated[16]; // first column of the window each fine segment of the kernel currently holds
+
+    for (int y = y0; y < y1; y++)
+    {
+        // Slide the column histograms down one row
+        if (y > y0)
+        {
+            const uchar *ptrOut = src.ptr<uchar>(std::min(std::max(y - radius - 1, 0), lastRow));
+            const uchar *ptrIn = src.ptr<uchar>(std::min(y + radius, lastRow));
+            for (int x = 0; x < padded; x++)
+            {
+                uchar out = ptrOut[offsets[x]];
+                uchar in = ptrIn[offsets[x]];
+                coarse[x * 16 + (out >> 4)]--;
+                fine[x * 256 + out]--;
+                coarse[x * 16 + (in >> 4)]++;
+                fine[x * 256 + in]++;
+            }
+        }
+
+        // Kernel coarse histogram for the first window, fine segments are filled on demand
+        memset(kernelCoarse, 0, sizeof(kernelCoarse));
+        for (int x = 0; x < diameter; x++)
+        {
+            for (int k = 0; k < 16; k++)
+            {
+                kernelCoarse[k] += coarse[x * 16 + k];
+            }
+        }
+        for (int k = 0; k < 16; k++)
+        {
+            lastUpdated[k] = -diameter;
+        }
+
+        uchar *ptrDst = dst.ptr<uchar>(y);
+        for (int x = 0; x < src.cols; x++)
+        {
+            // The window covers padded columns [x, x + 2 * radius]
+            if (x > 0)
+            {
+                const ushort *out = &coarse[(x - 1) * 16];
+                const ushort *in = &coarse[(x + 2 * radius) * 16];
+                for (int k = 0; k < 16; k++)
+                {
+                    kernelCoarse[k] += in[k] - out[k];
+                }
+            }
+
+            // Find the coarse bin holding the median
+            int sum = 0;
+            int k = 0;
+            while (sum + kernelCoarse[k] <= half)
+            {
+                sum += kernelCoarse[k];
+                k++;
+            }
+
+            // Bring the fine segment of that bin up to date with the current window
+            ushort *segment = kernelFine + k * 16;
+            if (x - lastUpdated[k] >= diameter)
+            {
+                memset(segment, 0, 16 * sizeof(ushort));
+                for (int j = x; j < x + diameter; j++)
+                {
+                    const ushort *col = &fine[j * 256 + k * 16];
+                    for (int b = 0; b < 16; b++)
+                    {
+                        segment[b] += col[b];
+                    }
+                }
+            }
+            else
+            {
+                for (int j = lastUpdated[k]; j < x; j++)
+                {
+                    const ushort *out = &fine[j * 256 + k * 16];
+                    const ushort *in = &fine[(j + diameter) * 256 + k * 16];
+                    for (int b = 0; b < 16; b++)
+                    {
+                        segment[b] += in[b] - out[b];
+                    }
+                }
+            }
+            lastUpdated[k] = x;
+
+            // Find the median inside the fine segment
+            int b = 0;
+            while (sum + segment[b] <= half)
+            {
+                sum += segment[b];
+                b++;
+            }
+
+            ptrDst[x * cn + c] = k * 16 + b;
+        }
+    }
+}
+
+/**
+ * @brief Apply a (2 * radius + 1) x (2 * radius + 1) median filter to an image.
+ *
+ * Uses the Perreault and Hebert algorithm: every column keeps a histogram of the pixels in its window, updated by one
+ * pixel in and one out per row, and the kernel histogram slides across the row by adding one column histogram and
+ * removing another. Histograms are split into 16 coarse and 256 fine bins, and the fine bins of the kernel are only
+ * brought up to date for the coarse bin that holds the median. The cost per pixel does not depend on the radius. The
+ * image is split into horizontal bands that are filtered in parallel. Edges are handled by replicating the border
+ * pixels.
+ *
+ * @param src The CV_8U source image with 1 to 4 channels.
+ * @param dst The destination image.
+ * @param radius The kernel radius, 0 to 127.
+ * @return 0 if successful, -1 if error.
+ */
+int medianFilter(const cv::Mat &src, cv::Mat &dst, int radius)
+{
+    if (src.empty() || src.depth() != CV_8U)
+    {
+        printf("Frame is empty or not CV_8U\n");
+        return -1;
+    }
+
+    // Window counts are kept in 16 bits
+    if (radius < 0 || radius > 127)
+    {
+        printf("Median radius must be in [0, 127]\n");
+        return -1;
+    }
+
+    if (radius == 0 || dst.data == src.data)
+    {
+        cv::Mat copy = src.clone();
+        if (radius == 0)
+        {
+            dst = copy;
+            return 0;
+        }
+        return medianFilter(copy, dst, radius);
+    }
+
+    dst.create(src.size(), src.type());
+
+    // Each band pays O(radius * cols) to build its column histograms, so keep bands much taller than the kernel
+    int bands = std::max(1, std::min(cv::getNumThreads(), src.rows / (4 * radius + 1)));
+
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range &range) {
+        std::vector<ushort> coarse((src.cols + 2 * radius) * 16);
+        std::vector<ushort> fine((src.cols + 2 * radius) * 256);
+
+        for (int band = range.start; band < range.end; band++)
+        {
+            int y0 = (int)((long long)src.rows * band / bands);
+            int y1 = (int)((long long)src.rows * (band + 1) / bands);
+            for (int c = 0; c < src.channels(); c++)
+            {
+                medianBandChannel(src, dst, radius, c, y0, y1, coarse, fine);
+            }
+        }
+    });
+
+    return 0;
+}
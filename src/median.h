@@ -0,0 +1,28 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Constant time median filter (Perreault and Hebert) for denoising images.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#ifndef MEDIAN_H
+#define MEDIAN_H
+
+/**
+ * @brief Apply a (2 * radius + 1) x (2 * radius + 1) median filter to an image.
+ *
+ * Uses the Perreault and Hebert algorithm: every column keeps a histogram of the pixels in its window, updated by one
+ * pixel in and one out per row, and the kernel histogram slides across the row by adding one column histogram and
+ * removing another. Histograms are split into 16 coarse and 256 fine bins, and the fine bins of the kernel are only
+ * brought up to date for the coarse bin that holds the median. The cost per pixel does not depend on the radius. The
+ * image is split into horizontal bands that are filtered in parallel. Edges are handled by replicating the border
+ * pixels.
+ *
+ * @param src The CV_8U source image with 1 to 4 channels.
+ * @param dst The destination image.
+ * @param radius The kernel radius, 0 to 127.
+ * @return 0 if successful, -1 if error.
+ */
+int medianFilter(const cv::Mat &src, cv::Mat &dst, int radius);
+
+#endif
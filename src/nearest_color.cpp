@@ -0,0 +1,358 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Vectorized search for the closest color of a palette, shared by the kmeans assignment and the color remap.
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "nearest_color.h"
+
+// The kernel is written with VTraits, v_sub and v_lt, which first appeared in OpenCV 4.8. Older versions and builds
+// without SIMD use the scalar loop.
+#if CV_SIMD && (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 8))
+#define NEAREST_COLOR_SIMD 1
+#else
+#define NEAREST_COLOR_SIMD 0
+#endif
+
+/**
+ * @brief Convert interleaved BGR pixels to the layout of ColorPlanes.
+ *
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @param planes The destination. Its buffers are reused when they are large enough.
+ */
+void toColorPlanes(const cv::Vec3b *pixels, size_t count, ColorPlanes &planes)
+{
+    planes.size = count;
+    if (planes.bg.size() < 2 * count)
+    {
+        planes.bg.resize(2 * count);
+        planes.r.resize(2 * count);
+    }
+
+    short *bg = planes.bg.data();
+    short *r = planes.r.data();
+    for (size_t j = 0; j < count; j++)
+    {
+        bg[2 * j] = pixels[j][0];
+        bg[2 * j + 1] = pixels[j][1];
+        r[2 * j] = pixels[j][2];
+        r[2 * j + 1] = 0;
+    }
+}
+
+/**
+ * @brief Find the closest color by SSD for every pixel in [begin, end).
+ *
+ * Each SIMD register holds the running minimum and its index for a group of pixels while all colors are broadcast
+ * against it. Ties go to the lowest index, the same as a scalar search with SSD.
+ *
+ * @param planes The pixels.
+ * @param begin The first pixel.
+ * @param end One past the last pixel.
+ * @param colors The palette.
+ * @param labels Receives the index of the closest color of pixel j at labels[j - begin].
+ */
+void nearestColors(const ColorPlanes &planes, size_t begin, size_t end, const std::vector<cv::Vec3b> &colors,
+                   int *labels)
+{
+    const int K = colors.size();
+    const short *bg = planes.bg.data();
+    const short *r = planes.r.data();
+
+    // every color as the two pairs of shorts the pixels are stored as, packed in an int for broadcasting
+    std::vector<int> bgPairs(K), rPairs(K);
+    for (int k = 0; k < K; k++)
+    {
+        bgPairs[k] = colors[k][0] | (colors[k][1] << 16);
+        rPairs[k] = colors[k][2];
+    }
+
+    size_t j = begin;
+#if NEAREST_COLOR_SIMD
+    // two registers of pixels per color, so the broadcasts are shared and the two minimum chains can overlap
+    const int lanes = cv::VTraits<cv::v_int32>::vlanes();
+    for (; j + 2 * lanes <= end; j += 2 * lanes)
+    {
+        cv::v_int16 bg0 = cv::vx_load(bg + 2 * j);
+        cv::v_int16 bg1 = cv::vx_load(bg + 2 * j + 2 * lanes);
+        cv::v_int16 r0 = cv::vx_load(r + 2 * j);
+        cv::v_int16 r1 = cv::vx_load(r + 2 * j + 2 * lanes);
+        cv::v_int32 best0 = cv::vx_setall_s32(INT_MAX), best1 = best0;
+        cv::v_int32 index0 = cv::vx_setall_s32(0), index1 = index0;
+        for (int k = 0; k < K; k++)
+        {
+            cv::v_int16 colorBg = cv::v_reinterpret_as_s16(cv::vx_setall_s32(bgPairs[k]));
+            cv::v_int16 colorR = cv::v_reinterpret_as_s16(cv::vx_setall_s32(rPairs[k]));
+            cv::v_int32 index = cv::vx_setall_s32(k);
+
+            cv::v_int16 dbg0 = cv::v_sub(bg0, colorBg), dr0 = cv::v_sub(r0, colorR);
+            cv::v_int16 dbg1 = cv::v_sub(bg1, colorBg), dr1 = cv::v_sub(r1, colorR);
+            cv::v_int32 ssd0 = cv::v_add(cv::v_dotprod(dbg0, dbg0), cv::v_dotprod(dr0, dr0));
+            cv::v_int32 ssd1 = cv::v_add(cv::v_dotprod(dbg1, dbg1), cv::v_dotprod(dr1, dr1));
+
+            cv::v_int32 closer0 = cv::v_lt(ssd0, best0);
+            cv::v_int32 closer1 = cv::v_lt(ssd1, best1);
+            best0 = cv::v_select(closer0, ssd0, best0);
+            best1 = cv::v_select(closer1, ssd1, best1);
+            index0 = cv::v_select(closer0, index, index0);
+            index1 = cv::v_select(closer1, index, index1);
+        }
+        cv::v_store(labels + (j - begin), index0);
+        cv::v_store(labels + (j - begin) + lanes, index1);
+    }
+#endif
+
+    // remaining pixels, or all of them without SIMD
+    for (; j < end; j++)
+    {
+        int best = INT_MAX;
+        int index = 0;
+        for (int k = 0; k < K; k++)
+        {
+            int db = bg[2 * j] - colors[k][0];
+            int dg = bg[2 * j + 1] - colors[k][1];
+            int dr = r[2 * j] - colors[k][2];
+            int ssd = db * db + dg * dg + dr * dr;
+            if (ssd < best)
+            {
+                best = ssd;
+                index = k;
+            }
+        }
+        labels[j - begin] = index;
+    }
+}
+
+/**
+ * @brief Check whether nearestColors was compiled with SIMD.
+ *
+ * @return true if it uses SIMD registers, false if it falls back to a scalar loop.
+ */
+bool nearestColorsSimd()
+{
+#if NEAREST_COLOR_SIMD
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Replace every pixel of an image with its closest color of a palette.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image.
+ * @param colors The palette.
+ * @return 0 if successful, -1 if error.
+ */
+int remapNearestColors(const cv::Mat &src, cv::Mat &dst, const std::vector<cv::Vec3b> &colors)
+{
+    if (src.empty() || src.type() != CV_8UC3 || colors.empty())
+    {
+        printf("Error: remapNearestColors needs a CV_8UC3 image and at least one color\n");
+        return -1;
+    }
+
+    dst.create(src.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+        ColorPlanes planes;
+        std::vector<int> labels(src.cols);
+        for (int y = range.start; y < range.end; y++)
+        {
+            toColorPlanes(src.ptr<cv::Vec3b>(y), src.cols, planes);
+            nearestColors(planes, 0, src.cols, colors, labels.data());
+
+            cv::Vec3b *out = dst.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                out[x] = colors[labels[x]];
+            }
+        }
+    });
+
+    return 0;
+}
+
+/**
+ * @brief Build the color cube of a palette.
+ *
+ * The cost is proportional to the number of cells times the number of colors and does not depend on any image.
+ *
+ * @param colors The palette.
+ * @param lut The color cube.
+ * @param bits The number of bits per channel, from 1 to 6.
+ * @return 0 if successful, -1 if error.
+ */
+int buildPaletteLut(const std::vector<cv::Vec3b> &colors, PaletteLut &lut, int bits)
+{
+    if (colors.empty() || bits < 1 || bits > 6)
+    {
+        printf("Error: buildPaletteLut needs at least one color and 1 to 6 bits per channel\n");
+        return -1;
+    }
+
+    const int K = colors.size();
+    const int side = 1 << bits;
+    const int width = 256 >> bits;
+    lut.bits = bits;
+    lut.colors = colors;
+    lut.cells.resize(side * side * side);
+
+    // Every color of a cell is within radius of its center, at twice the scale so the center is an integer. A color
+    // more than twice the radius further from the center than the closest one can never be the closest in the cell.
+    const double radius = (width - 1) * std::sqrt(3.0);
+
+    // one set of candidate lists per slab of cells with the same first channel, numbered locally
+    std::vector<std::vector<int> > slabOffsets(side), slabCandidates(side);
+    cv::parallel_for_(cv::Range(0, side), [&](const cv::Range &range) {
+        std::vector<int> ssd(K);
+        for (int i = range.start; i < range.end; i++)
+        {
+            std::vector<int> &offsets = slabOffsets[i];
+            std::vector<int> &candidates = slabCandidates[i];
+            for (int cell = i * side * side; cell < (i + 1) * side * side; cell++)
+            {
+                int lo[3] = {i * width, ((cell >> bits) & (side - 1)) * width, (cell & (side - 1)) * width};
+
+                // the closest color to the center of the cell
+                int best = INT_MAX;
+                int index = 0;
+                for (int k = 0; k < K; k++)
+                {
+                    int d0 = 2 * lo[0] + width - 1 - 2 * colors[k][0];
+                    int d1 = 2 * lo[1] + width - 1 - 2 * colors[k][1];
+                    int d2 = 2 * lo[2] + width - 1 - 2 * colors[k][2];
+                    ssd[k] = d0 * d0 + d1 * d1 + d2 * d2;
+                    if (ssd[k] < best)
+                    {
+                        best = ssd[k];
+                        index = k;
+                    }
+                }
+                double limit = std::sqrt((double)best) + 2 * radius + 1e-6;
+                limit *= limit;
+
+                // A color k is closer than that color b to a pixel p when |p - b|^2 - |p - k|^2 > 0, or equal for
+                // k < b. This is linear in p, so it is enough to check the corner of the cell that maximizes it.
+                const cv::Vec3b &b = colors[index];
+                size_t first = candidates.size();
+                for (int k = 0; k < K; k++)
+                {
+                    if (ssd[k] > limit)
+                    {
+                        continue;
+                    }
+                    int gain = 0;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        int step = colors[k][c] - b[c];
+                        int p = step > 0 ? lo[c] + width - 1 : lo[c];
+                        gain += 2 * p * step + b[c] * b[c] - colors[k][c] * colors[k][c];
+                    }
+                    if (k == index || gain > 0 || (gain == 0 && k < index))
+                    {
+                        candidates.push_back(k);
+                    }
+                }
+
+                if (candidates.size() - first == 1)
+                {
+                    candidates.pop_back();
+                    lut.cells[cell] = index;
+                }
+                else
+                {
+                    lut.cells[cell] = -1 - (int)offsets.size();
+                    offsets.push_back(first);
+                }
+            }
+        }
+    });
+
+    // concatenate the lists of the slabs in order and renumber their cells
+    lut.offsets.clear();
+    lut.candidates.clear();
+    for (int i = 0; i < side; i++)
+    {
+        int listBase = lut.offsets.size();
+        int candidateBase = lut.candidates.size();
+        for (int cell = i * side * side; cell < (i + 1) * side * side; cell++)
+        {
+            if (lut.cells[cell] < 0)
+            {
+                lut.cells[cell] -= listBase;
+            }
+        }
+        for (size_t a = 0; a < slabOffsets[i].size(); a++)
+        {
+            lut.offsets.push_back(candidateBase + slabOffsets[i][a]);
+        }
+        lut.candidates.insert(lut.candidates.end(), slabCandidates[i].begin(), slabCandidates[i].end());
+    }
+    lut.offsets.push_back(lut.candidates.size());
+
+    return 0;
+}
+
+/**
+ * @brief Replace every pixel of an image with its closest color of a palette using its color cube.
+ *
+ * Gives the same result as remapNearestColors at a cost per pixel that does not depend on the size of the palette.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image.
+ * @param lut The color cube of the palette.
+ * @return 0 if successful, -1 if error.
+ */
+int remapPaletteLut(const cv::Mat &src, cv::Mat &dst, const PaletteLut &lut)
+{
+    if (src.empty() || src.type() != CV_8UC3 || lut.bits == 0)
+    {
+        printf("Error: remapPaletteLut needs a CV_8UC3 image and a built color cube\n");
+        return -1;
+    }
+
+    const int bits = lut.bits;
+    const int drop = 8 - bits;
+    dst.create(src.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++)
+        {
+            const cv::Vec3b *in = src.ptr<cv::Vec3b>(y);
+            cv::Vec3b *out = dst.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                cv::Vec3b pix = in[x];
+                int index = lut.cells[((pix[0] >> drop) << (2 * bits)) | ((pix[1] >> drop) << bits) | (pix[2] >> drop)];
+                if (index < 0)
+                {
+                    // near a boundary, search the few colors that can be the closest
+                    int list = -1 - index;
+                    int best = INT_MAX;
+                    for (int a = lut.offsets[list]; a < lut.offsets[list + 1]; a++)
+                    {
+                        const cv::Vec3b &color = lut.colors[lut.candidates[a]];
+                        int d0 = pix[0] - color[0], d1 = pix[1] - color[1], d2 = pix[2] - color[2];
+                        int ssd = d0 * d0 + d1 * d1 + d2 * d2;
+                        if (ssd < best)
+                        {
+                            best = ssd;
+                            index = lut.candidates[a];
+                        }
+                    }
+                }
+                out[x] = lut.colors[index];
+            }
+        }
+    });
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Vectorized search for the closest color of a palette, shared by the kmeans assignment and the color remap.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#ifndef NEAREST_COLOR_H
+#define NEAREST_COLOR_H
+
+// Bits per channel of the color cube of a PaletteLut, 5 gives 32^3 cells of 8 x 8 x 8 colors
+#define PALETTE_LUT_BITS 5
+
+/**
+ * @brief Pixels laid out for nearestColors.
+ *
+ * Every pixel is stored as two pairs of shorts, (b, g) in bg and (r, 0) in r. Subtracting a color broadcast in the same
+ * layout and multiply-adding each pair with itself (pmaddwd on x86) gives db^2 + dg^2 and dr^2 for one pixel per 32-bit
+ * lane, so a SIMD register produces the SSD of several pixels without any shuffles.
+ */
+struct ColorPlanes
+{
+    size_t size;
+    std::vector<short> bg;
+    std::vector<short> r;
+
+    ColorPlanes() : size(0)
+    {
+    }
+};
+
+/**
+ * @brief Convert interleaved BGR pixels to the layout of ColorPlanes.
+ *
+ * @param pixels The pixels.
+ * @param count The number of pixels.
+ * @param planes The destination. Its buffers are reused when they are large enough.
+ */
+void toColorPlanes(const cv::Vec3b *pixels, size_t count, ColorPlanes &planes);
+
+/**
+ * @brief Find the closest color by SSD for every pixel in [begin, end).
+ *
+ * Each SIMD register holds the running minimum and its index for a group of pixels while all colors are broadcast
+ * against it. Ties go to the lowest index, the same as a scalar search with SSD.
+ *
+ * @param planes The pixels.
+ * @param begin The first pixel.
+ * @param end One past the last pixel.
+ * @param colors The palette.
+ * @param labels Receives the index of the closest color of pixel j at labels[j - begin].
+ */
+void nearestColors(const ColorPlanes &planes, size_t begin, size_t end, const std::vector<cv::Vec3b> &colors,
+                   int *labels);
+
+/**
+ * @brief Check whether nearestColors was compiled with SIMD.
+ *
+ * @return true if it uses SIMD registers, false if it falls back to a scalar loop.
+ */
+bool nearestColorsSimd();
+
+/**
+ * @brief Replace every pixel of an image with its closest color of a palette.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image.
+ * @param colors The palette.
+ * @return 0 if successful, -1 if error.
+ */
+int remapNearestColors(const cv::Mat &src, cv::Mat &dst, const std::vector<cv::Vec3b> &colors);
+
+/**
+ * @brief A color cube that maps any color to its closest color of a palette.
+ *
+ * Every cell covers 2^(8 - bits) values per channel. A cell where only one palette color can be the closest for any of
+ * its colors stores that color directly. The other cells, those near the boundary between palette colors, store the
+ * short list of colors that can be the closest, which is searched per pixel. The result is exactly the closest color
+ * by SSD, with ties going to the lowest index.
+ */
+struct PaletteLut
+{
+    int bits;
+    std::vector<cv::Vec3b> colors;
+    std::vector<int> cells;      // the index of the closest color, or -1 - the number of the candidate list
+    std::vector<int> offsets;    // candidate list a is candidates[offsets[a]] to candidates[offsets[a + 1] - 1]
+    std::vector<int> candidates; // indices of colors, increasing within a list
+
+    PaletteLut() : bits(0)
+    {
+    }
+};
+
+/**
+ * @brief Build the color cube of a palette.
+ *
+ * The cost is proportional to the number of cells times the number of colors and does not depend on any image.
+ *
+ * @param colors The palette.
+ * @param lut The color cube.
+ * @param bits The number of bits per channel, from 1 to 6.
+ * @return 0 if successful, -1 if error.
+ */
+int buildPaletteLut(const std::vector<cv::Vec3b> &colors, PaletteLut &lut, int bits = PALETTE_LUT_BITS);
+
+/**
+ * @brief Replace every pixel of an image with its closest color of a palette using its color cube.
+ *
+ * Gives the same result as remapNearestColors at a cost per pixel that does not depend on the size of the palette.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The CV_8UC3 destination image.
+ * @param lut The color cube of the palette.
+ * @return 0 if successful, -1 if error.
+ */
+int remapPaletteLut(const cv::Mat &src, cv::Mat &dst, const PaletteLut &lut);
+
+#endif
@@ -0,0 +1,433 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Dominant color palette feature of an image, palette distances and an index for palette search.
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <queue>
+#include <vector>
+
+#include "kmeans.h"
+#include "palette_feature.h"
+
+/**
+ * @brief Extract the palette feature of an image with kmeans.
+ *
+ * @param image The CV_8UC3 image.
+ * @param feature Receives the palette.
+ * @param seed Seed of the random number generator of kmeans, the same seed gives the same palette.
+ * @return 0 if successful, -1 if error.
+ */
+int extractPaletteFeature(const cv::Mat &image, PaletteFeature &feature, uint64 seed)
+{
+    if (image.empty() || image.type() != CV_8UC3)
+    {
+        printf("error: extractPaletteFeature needs a CV_8UC3 image\n");
+        return -1;
+    }
+
+    // sample a grid of at most PALETTE_SAMPLES pixels
+    int step = std::max(1, (int)std::ceil(std::sqrt((double)image.total() / PALETTE_SAMPLES)));
+    std::vector<cv::Vec3b> data;
+    data.reserve((size_t)((image.rows + step - 1) / step) * ((image.cols + step - 1) / step));
+    for (int i = 0; i < image.rows; i += step)
+    {
+        const cv::Vec3b *ptr = image.ptr<cv::Vec3b>(i);
+        for (int j = 0; j < image.cols; j += step)
+        {
+            data.push_back(ptr[j]);
+        }
+    }
+
+    int K = std::min(PALETTE_COLORS, (int)data.size());
+    std::vector<cv::Vec3b> means;
+    cv::Mat labels;
+    // quiet, this runs once per image of a batch
+    if (kmeans(data, means, labels, K, 10, 0, KMEANS_SEED_PLUSPLUS, seed, KMEANS_ASSIGN_AUTO, NULL, false) != 0)
+    {
+        return -1;
+    }
+
+    // share of the pixels of every color in 1/255, rounded by largest remainder so the weights sum to 255
+    std::vector<int> counts(K, 0);
+    const uchar *label = labels.ptr<uchar>();
+    for (size_t j = 0; j < data.size(); j++)
+    {
+        counts[label[j]]++;
+    }
+    std::vector<int> weights(K), order(K);
+    std::vector<int64> remainders(K);
+    int assigned = 0;
+    for (int k = 0; k < K; k++)
+    {
+        weights[k] = (int)((int64)counts[k] * 255 / data.size());
+        remainders[k] = (int64)counts[k] * 255 % data.size();
+        assigned += weights[k];
+        order[k] = k;
+    }
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return remainders[a] > remainders[b] || (remainders[a] == remainders[b] && a < b); });
+    for (int k = 0; assigned < 255; k++, assigned++)
+    {
+        weights[order[k]]++;
+    }
+
+    // dominant color first
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return weights[a] > weights[b] || (weights[a] == weights[b] && a < b); });
+    memset(&feature, 0, sizeof(feature));
+    for (int k = 0; k < K; k++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            feature.colors[k][c] = means[order[k]][c];
+        }
+        feature.weights[k] = (uchar)weights[order[k]];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Write a palette feature as a feature vector of the CSV feature files.
+ *
+ * @param feature The palette.
+ * @param vector Receives blue, green, red and weight of every color, 4 * PALETTE_COLORS values.
+ */
+void paletteToVector(const PaletteFeature &feature, std::vector<float> &vector)
+{
+    vector.resize(4 * PALETTE_COLORS);
+    for (int k = 0; k < PALETTE_COLORS; k++)
+    {
+        vector[4 * k] = feature.colors[k][0];
+        vector[4 * k + 1] = feature.colors[k][1];
+        vector[4 * k + 2] = feature.colors[k][2];
+        vector[4 * k + 3] = feature.weights[k];
+    }
+}
+
+/**
+ * @brief Read a palette feature from a feature vector written by paletteToVector.
+ *
+ * @param vector The feature vector.
+ * @param feature Receives the palette.
+ * @return 0 if successful, -1 if error.
+ */
+int paletteFromVector(const std::vector<float> &vector, PaletteFeature &feature)
+{
+    if (vector.size() != 4 * PALETTE_COLORS)
+    {
+        printf("error: a palette feature has %d values, got %d\n", 4 * PALETTE_COLORS, (int)vector.size());
+        return -1;
+    }
+
+    for (int k = 0; k < PALETTE_COLORS; k++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            uchar value = cv::saturate_cast<uchar>(vector[4 * k + c]);
+            if (c < 3)
+            {
+                feature.colors[k][c] = value;
+            }
+            else
+            {
+                feature.weights[k] = value;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief The number of colors of a palette with a weight, the used entries come first.
+ */
+static int paletteSize(const PaletteFeature &feature)
+{
+    int n = 0;
+    while (n < PALETTE_COLORS && feature.weights[n] > 0)
+    {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief The SSD between two palette colors.
+ */
+static inline int colorSsd(const uchar *a, const uchar *b)
+{
+    int d0 = a[0] - b[0], d1 = a[1] - b[1], d2 = a[2] - b[2];
+    return d0 * d0 + d1 * d1 + d2 * d2;
+}
+
+/**
+ * @brief Compute the weighted nearest color distance between two palettes.
+ *
+ * Every color of each palette is matched to the closest color of the other, and the distances are averaged with the
+ * weights of the matched colors over both palettes.
+ *
+ * @param a The first palette.
+ * @param b The second palette.
+ * @return float The distance, in units of a color channel.
+ */
+float paletteDistance(const PaletteFeature &a, const PaletteFeature &b)
+{
+    const int na = paletteSize(a), nb = paletteSize(b);
+    int minA[PALETTE_COLORS], minB[PALETTE_COLORS];
+    std::fill(minB, minB + nb, INT_MAX);
+    for (int i = 0; i < na; i++)
+    {
+        minA[i] = INT_MAX;
+        for (int j = 0; j < nb; j++)
+        {
+            int ssd = colorSsd(a.colors[i], b.colors[j]);
+            minA[i] = std::min(minA[i], ssd);
+            minB[j] = std::min(minB[j], ssd);
+        }
+    }
+
+    float sum = 0;
+    int total = 0;
+    for (int i = 0; i < na; i++)
+    {
+        sum += a.weights[i] * std::sqrt((float)minA[i]);
+        total += a.weights[i];
+    }
+    for (int j = 0; j < nb; j++)
+    {
+        sum += b.weights[j] * std::sqrt((float)minB[j]);
+        total += b.weights[j];
+    }
+
+    return total > 0 ? sum / total : 0;
+}
+
+/**
+ * @brief Compute a greedy earth mover's distance between two palettes.
+ *
+ * The pairs of colors are visited from the closest and every pair moves as much weight as both colors have left. The
+ * result is at least the exact earth mover's distance and costs a sort of PALETTE_COLORS^2 pairs instead of a
+ * transportation problem.
+ *
+ * @param a The first palette.
+ * @param b The second palette.
+ * @return float The distance, in units of a color channel.
+ */
+float paletteEmd(const PaletteFeature &a, const PaletteFeature &b)
+{
+    const int na = paletteSize(a), nb = paletteSize(b);
+
+    // every pair as its SSD in the high bits and its indices in the low bits, so one sort orders them
+    int64 pairs[PALETTE_COLORS * PALETTE_COLORS];
+    int n = 0;
+    for (int i = 0; i < na; i++)
+    {
+        for (int j = 0; j < nb; j++)
+        {
+            pairs[n++] = ((int64)colorSsd(a.colors[i], b.colors[j]) << 16) | (i << 8) | j;
+        }
+    }
+    std::sort(pairs, pairs + n);
+
+    int leftA[PALETTE_COLORS], leftB[PALETTE_COLORS];
+    int total = 0;
+    for (int i = 0; i < na; i++)
+    {
+        leftA[i] = a.weights[i];
+        total += a.weights[i];
+    }
+    for (int j = 0; j < nb; j++)
+    {
+        leftB[j] = b.weights[j];
+    }
+
+    float sum = 0;
+    int moved = 0;
+    for (int p = 0; p < n && moved < total; p++)
+    {
+        int i = (pairs[p] >> 8) & 0xff, j = pairs[p] & 0xff;
+        int flow = std::min(leftA[i], leftB[j]);
+        if (flow > 0)
+        {
+            sum += flow * std::sqrt((float)(pairs[p] >> 16));
+            leftA[i] -= flow;
+            leftB[j] -= flow;
+            moved += flow;
+        }
+    }
+
+    return moved > 0 ? sum / moved : 0;
+}
+
+/**
+ * @brief Build the index of a set of palette features.
+ *
+ * @param features The palette features.
+ * @param index Receives the index.
+ * @param bits The number of bits per channel of the dominant color cells, from 1 to 8.
+ * @return 0 if successful, -1 if error.
+ */
+int buildPaletteIndex(const std::vector<PaletteFeature> &features, PaletteIndex &index, int bits)
+{
+    if (bits < 1 || bits > 8)
+    {
+        printf("error: bits must be in [1, 8]\n");
+        return -1;
+    }
+
+    const int drop = 8 - bits;
+    const int cells = 1 << (3 * bits);
+    index.bits = bits;
+    index.offsets.assign(cells + 1, 0);
+    index.minWeights.assign(cells, 255);
+    std::vector<int> cellOf(features.size());
+    for (size_t f = 0; f < features.size(); f++)
+    {
+        const uchar *dominant = features[f].colors[0];
+        int cell = ((dominant[0] >> drop) << (2 * bits)) | ((dominant[1] >> drop) << bits) | (dominant[2] >> drop);
+        cellOf[f] = cell;
+        index.offsets[cell + 1]++;
+        index.minWeights[cell] = std::min(index.minWeights[cell], features[f].weights[0]);
+    }
+    for (int c = 0; c < cells; c++)
+    {
+        index.offsets[c + 1] += index.offsets[c];
+    }
+
+    // counting sort by cell, keeping the order of the features within a cell
+    index.order.resize(features.size());
+    std::vector<int> next(index.offsets.begin(), index.offsets.end() - 1);
+    for (size_t f = 0; f < features.size(); f++)
+    {
+        index.order[next[cellOf[f]]++] = (int)f;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Find the palette features closest to a query.
+ *
+ * Gives the same matches as computing the distance to every feature, visiting only the cells of the index whose
+ * lower bound is below the distance of the topN-th match found so far. Within a cell, the same bound with the dominant
+ * color of each feature skips many features before their full distance.
+ *
+ * @param features The palette features.
+ * @param index The index of the features.
+ * @param query The query palette.
+ * @param topN The number of matches.
+ * @param metric PALETTE_METRIC_NEAREST or PALETTE_METRIC_EMD.
+ * @param matches Receives the feature index and distance of the closest features, closest first.
+ * @param compared If not NULL, receives the number of features whose distance was computed.
+ * @return 0 if successful, -1 if error.
+ */
+int searchPalettes(const std::vector<PaletteFeature> &features, const PaletteIndex &index, const PaletteFeature &query,
+                   int topN, int metric, std::vector<std::pair<int, float>> &matches, int *compared)
+{
+    if (topN < 1 || (metric != PALETTE_METRIC_NEAREST && metric != PALETTE_METRIC_EMD) ||
+        index.order.size() != features.size())
+    {
+        printf("error: searchPalettes needs topN at least 1, a known metric and the index of the features\n");
+        return -1;
+    }
+
+    // The dominant color d of a feature carries weight w, which has to be matched to, or moved to, some query color
+    // at a distance of at least the distance from the query colors to the cell of d. That costs at least w times it
+    // over the total weight, 510 for the nearest color distance that sums the weights of both palettes and 255 for
+    // the earth mover's distance.
+    const int bits = index.bits;
+    const int width = 1 << (8 - bits);
+    const int cells = 1 << (3 * bits);
+    const int nq = paletteSize(query);
+    const float total = metric == PALETTE_METRIC_NEAREST ? 510.0f : 255.0f;
+    std::vector<std::pair<float, int>> bounds;
+    for (int cell = 0; cell < cells; cell++)
+    {
+        if (index.offsets[cell + 1] == index.offsets[cell])
+        {
+            continue;
+        }
+        const int mask = (1 << bits) - 1;
+        int low[3] = {(cell >> (2 * bits)) * width, ((cell >> bits) & mask) * width, (cell & mask) * width};
+        int closest = INT_MAX;
+        for (int i = 0; i < nq; i++)
+        {
+            int ssd = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                int v = query.colors[i][c];
+                int d = v < low[c] ? low[c] - v : v > low[c] + width - 1 ? v - (low[c] + width - 1) : 0;
+                ssd += d * d;
+            }
+            closest = std::min(closest, ssd);
+        }
+        float bound = nq > 0 ? index.minWeights[cell] * std::sqrt((float)closest) / total : 0;
+        bounds.push_back(std::make_pair(bound * (1 - 1e-5f), cell));
+    }
+    std::sort(bounds.begin(), bounds.end());
+
+    // the worst of the best matches so far is on top
+    std::priority_queue<std::pair<float, int>> best;
+    int count = 0;
+    for (size_t b = 0; b < bounds.size(); b++)
+    {
+        if ((int)best.size() == topN && bounds[b].first > best.top().first)
+        {
+            break;
+        }
+        int cell = bounds[b].second;
+        for (int o = index.offsets[cell]; o < index.offsets[cell + 1]; o++)
+        {
+            int f = index.order[o];
+
+            // the same bound with the dominant color and weight of this feature
+            if ((int)best.size() == topN)
+            {
+                const uchar *dominant = features[f].colors[0];
+                int closest = INT_MAX;
+                for (int i = 0; i < nq; i++)
+                {
+                    closest = std::min(closest, colorSsd(dominant, query.colors[i]));
+                }
+                float bound = features[f].weights[0] * std::sqrt((float)closest) / total;
+                if (bound * (1 - 1e-5f) > best.top().first)
+                {
+                    continue;
+                }
+            }
+
+            float distance = metric == PALETTE_METRIC_NEAREST ? paletteDistance(query, features[f])
+                                                              : paletteEmd(query, features[f]);
+            count++;
+            if ((int)best.size() < topN)
+            {
+                best.push(std::make_pair(distance, f));
+            }
+            else if (std::make_pair(distance, f) < best.top())
+            {
+                best.pop();
+                best.push(std::make_pair(distance, f));
+            }
+        }
+    }
+
+    matches.resize(best.size());
+    for (int m = (int)best.size() - 1; m >= 0; m--)
+    {
+        matches[m] = std::make_pair(best.top().second, best.top().first);
+        best.pop();
+    }
+    if (compared != NULL)
+    {
+        *compared = count;
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Dominant color palette feature of an image, palette distances and an index for palette search.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#ifndef PALETTE_FEATURE_H
+#define PALETTE_FEATURE_H
+
+// Number of colors of a palette feature, 16 colors and weights take 64 bytes
+#define PALETTE_COLORS 16
+
+// Palette extraction clusters at most this many pixels sampled from a grid over the image
+#define PALETTE_SAMPLES 65536
+
+// Bits per channel of the dominant color cells of a PaletteIndex, 3 gives 8^3 cells
+#define PALETTE_INDEX_BITS 3
+
+// Distances between palettes
+#define PALETTE_METRIC_NEAREST 0 // every color matched to the closest color of the other palette, weighted, both ways
+#define PALETTE_METRIC_EMD 1     // greedy earth mover's distance, the closest pairs of colors exchange weight first
+
+/**
+ * @brief The dominant colors of an image and the share of the pixels of each.
+ *
+ * The colors are sorted by decreasing weight, so colors[0] is the dominant color. The weights are in 1/255 of the
+ * pixels and sum to 255. Unused entries have weight 0.
+ */
+struct PaletteFeature
+{
+    uchar colors[PALETTE_COLORS][3]; // BGR
+    uchar weights[PALETTE_COLORS];
+};
+
+/**
+ * @brief An index of palette features by the cell of their dominant color.
+ *
+ * Features are grouped by the cell of a coarse color cube their dominant color falls in. With the smallest dominant
+ * weight of a cell, the distance from a query to the cell gives a lower bound of the distance to every feature in it,
+ * so a search visits the cells from the lowest bound and stops once no cell can beat the matches it has.
+ */
+struct PaletteIndex
+{
+    int bits;
+    std::vector<int> offsets;      // the features of cell c are order[offsets[c]] to order[offsets[c + 1] - 1]
+    std::vector<int> order;        // feature indices grouped by cell
+    std::vector<uchar> minWeights; // the smallest dominant weight of each cell
+
+    PaletteIndex() : bits(0)
+    {
+    }
+};
+
+/**
+ * @brief Extract the palette feature of an image with kmeans.
+ *
+ * @param image The CV_8UC3 image.
+ * @param feature Receives the palette.
+ * @param seed Seed of the random number generator of kmeans, the same seed gives the same palette.
+ * @return 0 if successful, -1 if error.
+ */
+int extractPaletteFeature(const cv::Mat &image, PaletteFeature &feature, uint64 seed = 0);
+
+/**
+ * @brief Write a palette feature as a feature vector of the CSV feature files.
+ *
+ * @param feature The palette.
+ * @param vector Receives blue, green, red and weight of every color, 4 * PALETTE_COLORS values.
+ */
+void paletteToVector(const PaletteFeature &feature, std::vector<float> &vector);
+
+/**
+ * @brief Read a palette feature from a feature vector written by paletteToVector.
+ *
+ * @param vector The feature vector.
+ * @param feature Receives the palette.
+ * @return 0 if successful, -1 if error.
+ */
+int paletteFromVector(const std::vector<float> &vector, PaletteFeature &feature);
+
+/**
+ * @brief Compute the weighted nearest color distance between two palettes.
+ *
+ * Every color of each palette is matched to the closest color of the other, and the distances are averaged with the
+ * weights of the matched colors over both palettes.
+ *
+ * @param a The first palette.
+ * @param b The second palette.
+ * @return float The distance, in units of a color channel.
+ */
+float paletteDistance(const PaletteFeature &a, const PaletteFeature &b);
+
+/**
+ * @brief Compute a greedy earth mover's distance between two palettes.
+ *
+ * The pairs of colors are visited from the closest and every pair moves as much weight as both colors have left. The
+ * result is at least the exact earth mover's distance and costs a sort of PALETTE_COLORS^2 pairs instead of a
+ * transportation problem.
+ *
+ * @param a The first palette.
+ * @param b The second palette.
+ * @return float The distance, in units of a color channel.
+ */
+float paletteEmd(const PaletteFeature &a, const PaletteFeature &b);
+
+/**
+ * @brief Build the index of a set of palette features.
+ *
+ * @param features The palette features.
+ * @param index Receives the index.
+ * @param bits The number of bits per channel of the dominant color cells, from 1 to 8.
+ * @return 0 if successful, -1 if error.
+ */
+int buildPaletteIndex(const std::vector<PaletteFeature> &features, PaletteIndex &index, int bits = PALETTE_INDEX_BITS);
+
+/**
+ * @brief Find the palette features closest to a query.
+ *
+ * Gives the same matches as computing the distance to every feature, visiting only the cells of the index whose
+ * lower bound is below the distance of the topN-th match found so far. Within a cell, the same bound with the dominant
+ * color of each feature skips many features before their full distance.
+ *
+ * @param features The palette features.
+ * @param index The index of the features.
+ * @param query The query palette.
+ * @param topN The number of matches.
+ * @param metric PALETTE_METRIC_NEAREST or PALETTE_METRIC_EMD.
+ * @param matches Receives the feature index and distance of the closest features, closest first.
+ * @param compared If not NULL, receives the number of features whose distance was computed.
+ * @return 0 if successful, -1 if error.
+ */
+int searchPalettes(const std::vector<PaletteFeature> &features, const PaletteIndex &index, const PaletteFeature &query,
+                   int topN, int metric, std::vector<std::pair<int, float>> &matches, int *compared = NULL);
+
+#endif
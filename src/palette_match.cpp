@@ -0,0 +1,92 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Given a target image and the palette features of a directory of images, finds the images with the closest
+// dominant colors.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "csv_util.h"
+#include "palette_feature.h"
+
+/**
+ * @brief Main function to find the top N matches for a target image by its dominant color palette
+ *
+ * This function extracts the palette of the target image, reads the palettes written by feature_extract with feature
+ * type 1, indexes them by their dominant color and prints the top N matches. The distance is the weighted nearest
+ * color distance by default or the greedy earth mover's distance.
+ *
+ * @param argc The number of command line arguments
+ * @param argv The command line arguments
+ * @return int The exit status
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <targetImage> [topN] [metric] [vectorCsvFile]\n", argv[0]);
+        printf("Metric: \n0 for weighted nearest color (default) \n1 for earth mover's distance\n");
+        exit(-1);
+    }
+
+    printf("\n\n========== Palette Match ==========\n\n");
+
+    int topN = argc > 2 ? atoi(argv[2]) : 3;
+    int metric = argc > 3 ? atoi(argv[3]) : PALETTE_METRIC_NEAREST;
+    std::string vectorCsv = argc > 4 ? argv[4] : "feature_vectors/palette_vectors.csv";
+    printf("Target image set to %s\n", argv[1]);
+    printf("Using topN: %d, metric: %d, feature vector file: %s\n", topN, metric, vectorCsv.c_str());
+
+    cv::Mat image = cv::imread(argv[1]);
+    if (!image.data)
+    {
+        printf("No image data\n");
+        return -1;
+    }
+
+    printf("Extracting the palette of the target image ...\n");
+    PaletteFeature target;
+    if (extractPaletteFeature(image, target) != 0)
+    {
+        return -1;
+    }
+
+    printf("Reading palette features from file...\n");
+    std::vector<std::pair<std::string, std::vector<float>>> featureVectors = readFeatureVectorsFromCSV(vectorCsv);
+    std::vector<std::string> filenames;
+    std::vector<PaletteFeature> palettes;
+    for (const auto &pair : featureVectors)
+    {
+        PaletteFeature palette;
+        if (paletteFromVector(pair.second, palette) == 0)
+        {
+            filenames.push_back(pair.first);
+            palettes.push_back(palette);
+        }
+    }
+    printf("Read %lu palettes\n", palettes.size());
+
+    PaletteIndex index;
+    std::vector<std::pair<int, float>> matches;
+    int compared = 0;
+    if (buildPaletteIndex(palettes, index) != 0 ||
+        searchPalettes(palettes, index, target, topN, metric, matches, &compared) != 0)
+    {
+        return -1;
+    }
+    printf("Compared %d of %lu palettes\n", compared, palettes.size());
+
+    printf("\n================\n\n");
+    printf("Top matches: \n");
+    for (const auto &match : matches)
+    {
+        std::cout << "Image: " << filenames[match.first] << ", Distance: " << match.second << std::endl;
+    }
+    printf("\n================\n\n");
+
+    return 0;
+}
@@ -0,0 +1,405 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Planar (one plane per channel) image representation and the planar versions of the filters in filter.h.
+//
+// Every kernel below walks a single plane with unit stride and no per-channel inner loop, so the compiler can
+// vectorize the x loops directly. Convert with bgrToPlanar once, run as many planar stages as needed and convert back
+// with planarToBgr at the end.
+
+#include <cmath>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "planar.h"
+
+/**
+ * @brief Allocate the planes. Existing planes are reused when the size and depth already match.
+ *
+ * @param rows The number of image rows.
+ * @param cols The number of image columns.
+ * @param depth CV_8U or CV_16S.
+ */
+void PlanarImage::create(int rows, int cols, int depth)
+{
+    CV_Assert(depth == CV_8U || depth == CV_16S);
+
+    int elemSize = depth == CV_16S ? 2 : 1;
+    int rowBytes = (int)cv::alignSize((size_t)cols * elemSize + 2 * PLANAR_ALIGN, PLANAR_ALIGN);
+
+    this->rows = rows;
+    this->cols = cols;
+    this->depth = depth;
+
+    for (int c = 0; c < 3; c++)
+    {
+        planes[c].create(rows + 2 * PLANAR_BORDER, rowBytes / elemSize, depth);
+    }
+}
+
+/**
+ * @brief Replicate the edge pixels of one plane into its border.
+ *
+ * @param img The planar image.
+ * @param c The plane index.
+ */
+template <typename T> static void replicatePlane(PlanarImage &img, int c)
+{
+    for (int y = 0; y < img.rows; y++)
+    {
+        T *ptr = img.ptr<T>(c, y);
+        for (int b = 1; b <= PLANAR_BORDER; b++)
+        {
+            ptr[-b] = ptr[0];
+            ptr[img.cols - 1 + b] = ptr[img.cols - 1];
+        }
+    }
+
+    // Copy whole padded rows so the corners are filled as well
+    size_t rowBytes = img.planes[c].cols * sizeof(T);
+    for (int b = 1; b <= PLANAR_BORDER; b++)
+    {
+        memcpy(img.planes[c].ptr<T>(PLANAR_BORDER - b), img.planes[c].ptr<T>(PLANAR_BORDER), rowBytes);
+        memcpy(img.planes[c].ptr<T>(PLANAR_BORDER + img.rows - 1 + b),
+               img.planes[c].ptr<T>(PLANAR_BORDER + img.rows - 1), rowBytes);
+    }
+}
+
+/**
+ * @brief Refill the replicated border of every plane from the edge pixels.
+ *
+ * Every planar filter calls this on its output so the result can be fed straight into the next stage.
+ *
+ * @param img The planar image.
+ */
+void replicatePlanarBorder(PlanarImage &img)
+{
+    if (img.empty())
+    {
+        return;
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        if (img.depth == CV_16S)
+        {
+            replicatePlane<short>(img, c);
+        }
+        else
+        {
+            replicatePlane<uchar>(img, c);
+        }
+    }
+}
+
+/**
+ * @brief Convert an interleaved BGR image to planar form.
+ *
+ * The border of each plane is filled by replicating the edge pixels.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int bgrToPlanar(const cv::Mat &src, PlanarImage &dst)
+{
+    if (src.empty() || src.type() != CV_8UC3)
+    {
+        printf("Frame is empty or not CV_8UC3\n");
+        return -1;
+    }
+
+    dst.create(src.rows, src.cols, CV_8U);
+
+    for (int y = 0; y < src.rows; y++)
+    {
+        const uchar *ptr = src.ptr<uchar>(y);
+        uchar *blue = dst.ptr<uchar>(0, y);
+        uchar *green = dst.ptr<uchar>(1, y);
+        uchar *red = dst.ptr<uchar>(2, y);
+
+        for (int x = 0; x < src.cols; x++)
+        {
+            blue[x] = ptr[3 * x];
+            green[x] = ptr[3 * x + 1];
+            red[x] = ptr[3 * x + 2];
+        }
+    }
+
+    replicatePlanarBorder(dst);
+
+    return 0;
+}
+
+/**
+ * @brief Interleave the three planes into dst, row by row.
+ */
+template <typename T> static void interleaveRows(const PlanarImage &src, cv::Mat &dst)
+{
+    for (int y = 0; y < src.rows; y++)
+    {
+        const T *blue = src.ptr<T>(0, y);
+        const T *green = src.ptr<T>(1, y);
+        const T *red = src.ptr<T>(2, y);
+        T *ptr = dst.ptr<T>(y);
+
+        for (int x = 0; x < src.cols; x++)
+        {
+            ptr[3 * x] = blue[x];
+            ptr[3 * x + 1] = green[x];
+            ptr[3 * x + 2] = red[x];
+        }
+    }
+}
+
+/**
+ * @brief Convert a planar image back to an interleaved image.
+ *
+ * CV_8U planes produce a CV_8UC3 image and CV_16S planes produce a CV_16SC3 image.
+ *
+ * @param src The planar source image.
+ * @param dst The interleaved destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int planarToBgr(const PlanarImage &src, cv::Mat &dst)
+{
+    if (src.empty())
+    {
+        printf("Frame is empty\n");
+        return -1;
+    }
+
+    if (src.depth == CV_16S)
+    {
+        dst.create(src.rows, src.cols, CV_16SC3);
+        interleaveRows<short>(src, dst);
+    }
+    else
+    {
+        dst.create(src.rows, src.cols, CV_8UC3);
+        interleaveRows<uchar>(src, dst);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Blur a planar image using separable 1x5 Gaussian kernels.
+ *
+ * Same [1 2 4 2 1] / 10 horizontal and vertical passes as blur5x5_2, but every pixel is computed because the border is
+ * replicated.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_8U planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int blur5x5Planar(const PlanarImage &src, PlanarImage &dst)
+{
+    if (src.empty() || src.depth != CV_8U)
+    {
+        printf("Frame is empty or not CV_8U\n");
+        return -1;
+    }
+
+    PlanarImage temp; // Temporary image used for horizontal pass
+    temp.create(src.rows, src.cols, CV_8U);
+
+    // Horizontal pass
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < src.rows; y++)
+        {
+            const uchar *ptr = src.ptr<uchar>(c, y);
+            uchar *ptrTemp = temp.ptr<uchar>(c, y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                ptrTemp[x] = (ptr[x - 2] + 2 * ptr[x - 1] + 4 * ptr[x] + 2 * ptr[x + 1] + ptr[x + 2]) / 10;
+            }
+        }
+    }
+    replicatePlanarBorder(temp);
+
+    // Vertical pass
+    dst.create(src.rows, src.cols, CV_8U);
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < src.rows; y++)
+        {
+            const uchar *ptrTwoUp = temp.ptr<uchar>(c, y - 2);
+            const uchar *ptrOneUp = temp.ptr<uchar>(c, y - 1);
+            const uchar *ptr = temp.ptr<uchar>(c, y);
+            const uchar *ptrOneDown = temp.ptr<uchar>(c, y + 1);
+            const uchar *ptrTwoDown = temp.ptr<uchar>(c, y + 2);
+            uchar *ptrDst = dst.ptr<uchar>(c, y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                ptrDst[x] = (ptrTwoUp[x] + 2 * ptrOneUp[x] + 4 * ptr[x] + 2 * ptrOneDown[x] + ptrTwoDown[x]) / 10;
+            }
+        }
+    }
+    replicatePlanarBorder(dst);
+
+    return 0;
+}
+
+/**
+ * @brief Apply the 3x3 Sobel X kernel to a planar image.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_16S planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelX3x3Planar(const PlanarImage &src, PlanarImage &dst)
+{
+    // -1  0  1
+    // -2  0  2
+    // -1  0  1
+    if (src.empty() || src.depth != CV_8U)
+    {
+        printf("Frame is empty or not CV_8U\n");
+        return -1;
+    }
+
+    dst.create(src.rows, src.cols, CV_16S);
+
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < src.rows; y++)
+        {
+            const uchar *ptrUp = src.ptr<uchar>(c, y - 1);
+            const uchar *ptr = src.ptr<uchar>(c, y);
+            const uchar *ptrDown = src.ptr<uchar>(c, y + 1);
+            short *ptrDst = dst.ptr<short>(c, y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                ptrDst[x] = (short)((ptrUp[x + 1] - ptrUp[x - 1]) + 2 * (ptr[x + 1] - ptr[x - 1]) +
+                                    (ptrDown[x + 1] - ptrDown[x - 1]));
+            }
+        }
+    }
+    replicatePlanarBorder(dst);
+
+    return 0;
+}
+
+/**
+ * @brief Apply the 3x3 Sobel Y kernel to a planar image.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_16S planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelY3x3Planar(const PlanarImage &src, PlanarImage &dst)
+{
+    // -1 -2 -1
+    //  0  0  0
+    //  1  2  1
+    if (src.empty() || src.depth != CV_8U)
+    {
+        printf("Frame is empty or not CV_8U\n");
+        return -1;
+    }
+
+    dst.create(src.rows, src.cols, CV_16S);
+
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < src.rows; y++)
+        {
+            const uchar *ptrUp = src.ptr<uchar>(c, y - 1);
+            const uchar *ptrDown = src.ptr<uchar>(c, y + 1);
+            short *ptrDst = dst.ptr<short>(c, y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                ptrDst[x] = (short)((ptrDown[x - 1] - ptrUp[x - 1]) + 2 * (ptrDown[x] - ptrUp[x]) +
+                                    (ptrDown[x + 1] - ptrUp[x + 1]));
+            }
+        }
+    }
+    replicatePlanarBorder(dst);
+
+    return 0;
+}
+
+/**
+ * @brief Calculate the gradient magnitude from planar Sobel X and Y images.
+ *
+ * Unlike magnitude() the result saturates at 255 instead of wrapping around.
+ *
+ * @param sx The CV_16S planar image with a sobel x filter applied.
+ * @param sy The CV_16S planar image with a sobel y filter applied.
+ * @param dst The CV_8U planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int magnitudePlanar(const PlanarImage &sx, const PlanarImage &sy, PlanarImage &dst)
+{
+    if (sx.empty() || sy.empty() || sx.depth != CV_16S || sy.depth != CV_16S)
+    {
+        printf("Frame is empty or not CV_16S\n");
+        return -1;
+    }
+
+    dst.create(sx.rows, sx.cols, CV_8U);
+
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < dst.rows; y++)
+        {
+            const short *ptrSx = sx.ptr<short>(c, y);
+            const short *ptrSy = sy.ptr<short>(c, y);
+            uchar *ptrDst = dst.ptr<uchar>(c, y);
+            for (int x = 0; x < dst.cols; x++)
+            {
+                float gx = ptrSx[x];
+                float gy = ptrSy[x];
+                ptrDst[x] = (uchar)std::min(std::sqrt(gx * gx + gy * gy), 255.0f);
+            }
+        }
+    }
+    replicatePlanarBorder(dst);
+
+    return 0;
+}
+
+/**
+ * @brief Calculate the gradient magnitude of a planar image.
+ *
+ * The Sobel X and Y responses are computed per row and consumed immediately, so no gradient planes are allocated.
+ * dst must not be the same image as src.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_8U planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int magnitudePlanar(const PlanarImage &src, PlanarImage &dst)
+{
+    if (src.empty() || src.depth != CV_8U)
+    {
+        printf("Frame is empty or not CV_8U\n");
+        return -1;
+    }
+
+    dst.create(src.rows, src.cols, CV_8U);
+
+    for (int c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < src.rows; y++)
+        {
+            const uchar *ptrUp = src.ptr<uchar>(c, y - 1);
+            const uchar *ptr = src.ptr<uchar>(c, y);
+            const uchar *ptrDown = src.ptr<uchar>(c, y + 1);
+            uchar *ptrDst = dst.ptr<uchar>(c, y);
+            for (int x = 0; x < src.cols; x++)
+            {
+                float gx = (ptrUp[x + 1] - ptrUp[x - 1]) + 2 * (ptr[x + 1] - ptr[x - 1]) +
+                           (ptrDown[x + 1] - ptrDown[x - 1]);
+                float gy = (ptrDown[x - 1] - ptrUp[x - 1]) + 2 * (ptrDown[x] - ptrUp[x]) +
+                           (ptrDown[x + 1] - ptrUp[x + 1]);
+                ptrDst[x] = (uchar)std::min(std::sqrt(gx * gx + gy * gy), 255.0f);
+            }
+        }
+    }
+    replicatePlanarBorder(dst);
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Planar (one plane per channel) image representation and the planar versions of the filters in filter.h.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#ifndef PLANAR_H
+#define PLANAR_H
+
+// Row stride and left padding of every plane are rounded up to this many bytes so each interior row starts aligned.
+#define PLANAR_ALIGN 32
+
+// Number of replicated border rows and columns kept around every plane (enough for a 5x5 kernel).
+#define PLANAR_BORDER 2
+
+/**
+ * @brief A three channel image stored as three separate, aligned and padded planes.
+ *
+ * Each plane is a single channel cv::Mat that is larger than the image by PLANAR_BORDER rows above and below and by
+ * PLANAR_ALIGN bytes on the left, with the row length rounded up to PLANAR_ALIGN. The interior of every row is
+ * therefore aligned and a kernel can read up to PLANAR_BORDER pixels past any edge without bounds checks. Planes are
+ * either CV_8U (images) or CV_16S (signed gradients).
+ */
+struct PlanarImage
+{
+    int rows;
+    int cols;
+    int depth;
+    cv::Mat planes[3];
+
+    PlanarImage() : rows(0), cols(0), depth(CV_8U)
+    {
+    }
+
+    /**
+     * @brief Allocate the planes. Existing planes are reused when the size and depth already match.
+     *
+     * @param rows The number of image rows.
+     * @param cols The number of image columns.
+     * @param depth CV_8U or CV_16S.
+     */
+    void create(int rows, int cols, int depth = CV_8U);
+
+    bool empty() const
+    {
+        return rows == 0 || cols == 0;
+    }
+
+    /**
+     * @brief Get a pointer to pixel (y, 0) of plane c. Negative y and x offsets down to -PLANAR_BORDER are valid.
+     */
+    template <typename T> T *ptr(int c, int y)
+    {
+        return planes[c].ptr<T>(y + PLANAR_BORDER) + PLANAR_ALIGN / sizeof(T);
+    }
+
+    template <typename T> const T *ptr(int c, int y) const
+    {
+        return planes[c].ptr<T>(y + PLANAR_BORDER) + PLANAR_ALIGN / sizeof(T);
+    }
+};
+
+/**
+ * @brief Convert an interleaved BGR image to planar form.
+ *
+ * The border of each plane is filled by replicating the edge pixels.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int bgrToPlanar(const cv::Mat &src, PlanarImage &dst);
+
+/**
+ * @brief Convert a planar image back to an interleaved image.
+ *
+ * CV_8U planes produce a CV_8UC3 image and CV_16S planes produce a CV_16SC3 image.
+ *
+ * @param src The planar source image.
+ * @param dst The interleaved destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int planarToBgr(const PlanarImage &src, cv::Mat &dst);
+
+/**
+ * @brief Refill the replicated border of every plane from the edge pixels.
+ *
+ * Every planar filter calls this on its output so the result can be fed straight into the next stage.
+ *
+ * @param img The planar image.
+ */
+void replicatePlanarBorder(PlanarImage &img);
+
+/**
+ * @brief Blur a planar image using separable 1x5 Gaussian kernels.
+ *
+ * Same [1 2 4 2 1] / 10 horizontal and vertical passes as blur5x5_2, but every pixel is computed because the border is
+ * replicated.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_8U planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int blur5x5Planar(const PlanarImage &src, PlanarImage &dst);
+
+/**
+ * @brief Apply the 3x3 Sobel X kernel to a planar image.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_16S planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelX3x3Planar(const PlanarImage &src, PlanarImage &dst);
+
+/**
+ * @brief Apply the 3x3 Sobel Y kernel to a planar image.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_16S planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int sobelY3x3Planar(const PlanarImage &src, PlanarImage &dst);
+
+/**
+ * @brief Calculate the gradient magnitude from planar Sobel X and Y images.
+ *
+ * Unlike magnitude() the result saturates at 255 instead of wrapping around.
+ *
+ * @param sx The CV_16S planar image with a sobel x filter applied.
+ * @param sy The CV_16S planar image with a sobel y filter applied.
+ * @param dst The CV_8U planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int magnitudePlanar(const PlanarImage &sx, const PlanarImage &sy, PlanarImage &dst);
+
+/**
+ * @brief Calculate the gradient magnitude of a planar image.
+ *
+ * The Sobel X and Y responses are computed per row and consumed immediately. dst must not be the same image as src.
+ *
+ * @param src The CV_8U planar source image.
+ * @param dst The CV_8U planar destination image.
+ * @return 0 if successful, -1 if error.
+ */
+int magnitudePlanar(const PlanarImage &src, PlanarImage &dst);
+
+#endif
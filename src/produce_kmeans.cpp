@@ -0,0 +1,295 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Runs kmeans on the colors of an image, a video or a benchmark of palette methods. Moved out of kmeans.cpp so
+// the kmeans functions can be linked into other programs.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "kmeans.h"
+#include "nearest_color.h"
+#include "quantize.h"
+
+/*
+  source: a video file name, or the index of a camera
+  K: the number of clusters
+  step: the sampling step of kmeansVideoFrame
+  changeThresh: the label change threshold of kmeansVideoFrame
+
+  Quantizes every frame of a video to a palette that follows the frames, and shows the result until a key is pressed.
+ */
+static int runVideo(const char *source, int K, int step, double changeThresh)
+{
+    cv::VideoCapture capture;
+    char *end;
+    long index = strtol(source, &end, 10);
+    if (*end == '\0')
+    {
+        capture.open((int)index);
+    }
+    else
+    {
+        capture.open(source);
+    }
+    if (!capture.isOpened())
+    {
+        printf("Unable to open video %s\n", source);
+        return -1;
+    }
+
+    KmeansVideo state;
+    PaletteLut lut;
+    KmeansStats stats;
+    cv::Mat frame, quantized;
+    for (int n = 0; capture.read(frame); n++)
+    {
+        double t = (double)cv::getTickCount();
+        if (kmeansVideoFrame(frame, state, K, step, 10, changeThresh, 0, &stats) != 0 ||
+            buildPaletteLut(state.means, lut) != 0 || remapPaletteLut(frame, quantized, lut) != 0)
+        {
+            return -1;
+        }
+        t = ((double)cv::getTickCount() - t) * 1000 / cv::getTickFrequency();
+        printf("Frame %d: %d iterations, %.2f ms\n", n, stats.iterations, t);
+
+        cv::imshow("Original", frame);
+        cv::imshow("K-means", quantized);
+        if (cv::waitKey(1) >= 0)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+  filename: the image
+  K: the number of colors
+
+  Builds a palette of K colors for an image with kmeans on every pixel, kmeans on the color cube, median cut and
+  octree, maps the image to each palette with the same palette LUT, and prints the time to build each palette and the
+  MSE and PSNR of each result.
+ */
+static int runBenchmark(const char *filename, int K)
+{
+    cv::Mat image = cv::imread(filename);
+    if (image.empty())
+    {
+        printf("No image data\n");
+        return -1;
+    }
+
+    std::vector<cv::Vec3b> data;
+    for (int i = 0; i < image.rows; i++)
+    {
+        const cv::Vec3b *ptr = image.ptr<cv::Vec3b>(i);
+        data.insert(data.end(), ptr, ptr + image.cols);
+    }
+    std::vector<int> labels(data.size());
+
+    const char *names[4] = {"kmeans", "kmeans histogram", "median cut", "octree"};
+    printf("\n%-18s %8s %10s %10s %8s\n", "method", "colors", "time (ms)", "MSE", "PSNR");
+    for (int method = 0; method < 4; method++)
+    {
+        std::vector<cv::Vec3b> palette;
+        double t = (double)cv::getTickCount();
+        int status;
+        switch (method)
+        {
+        case 0:
+            status = kmeans(data, palette, labels.data(), K, 10, 0, KMEANS_SEED_PLUSPLUS, 0);
+            break;
+        case 1:
+            status = kmeansHistogram(image, palette, K);
+            break;
+        case 2:
+            status = medianCutPalette(image, palette, K);
+            break;
+        default:
+            status = octreePalette(image, palette, K);
+            break;
+        }
+        t = ((double)cv::getTickCount() - t) * 1000 / cv::getTickFrequency();
+
+        PaletteLut lut;
+        cv::Mat quantized;
+        double mse, psnr;
+        if (status != 0 || buildPaletteLut(palette, lut) != 0 || remapPaletteLut(image, quantized, lut) != 0 ||
+            quantizationError(image, quantized, mse, psnr) != 0)
+        {
+            return -1;
+        }
+        printf("%-18s %8d %10.2f %10.2f %8.2f\n", names[method], (int)palette.size(), t, mse, psnr);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+    {
+        if (argc < 4)
+        {
+            printf("Usage: %s --benchmark <image filename> <# of colors>\n", argv[0]);
+            exit(-1);
+        }
+        return runBenchmark(argv[2], atoi(argv[3]));
+    }
+    if (argc > 1 && strcmp(argv[1], "--video") == 0)
+    {
+        if (argc < 4)
+        {
+            printf("Usage: %s --video <video filename or camera index> <# of colors> [step] [change threshold]\n",
+                   argv[0]);
+            exit(-1);
+        }
+        return runVideo(argv[2], atoi(argv[3]), argc > 4 ? atoi(argv[4]) : 2, argc > 5 ? atof(argv[5]) : 0.01);
+    }
+
+    if (argc < 3)
+    {
+        printf("Usage: %s <image filename> <# of colors> [seeding] [seed] [batch size] [histogram bits] [restarts] "
+               "[cancel slack]\n", argv[0]);
+        printf("Seeding: \n0 for comb sampling \n1 for k-means++ \n2 for k-means||\n");
+        printf("Batch size: 0 for full batch k-means (default), > 0 for mini-batch k-means\n");
+        printf("Histogram bits: 0 to cluster every pixel (default), 1 to %d to cluster a color cube\n",
+               QUANTIZE_HISTOGRAM_MAX_BITS);
+        printf("Restarts: 1 for a single run (default), > 1 to keep the best of that many concurrent runs\n");
+        printf("Cancel slack: negative to run every restart to the end so the seed reproduces the result (default), "
+               ">= 0 to cancel restarts worse than 1 + slack times the best one, e.g. %.2f\n",
+               KMEANS_RESTART_SLACK);
+        printf("Benchmark: %s --benchmark <image filename> <# of colors>\n", argv[0]);
+        printf("Video: %s --video <video filename or camera index> <# of colors> [step] [change threshold]\n",
+               argv[0]);
+        exit(-1);
+    }
+
+    int seeding = argc > 3 ? atoi(argv[3]) : KMEANS_SEED_PLUSPLUS;
+    uint64 seed = argc > 4 ? strtoull(argv[4], NULL, 10) : (uint64)time(NULL);
+    printf("Seeding: %d, seed: %llu\n", seeding, (unsigned long long)seed);
+    int batchSize = argc > 5 ? atoi(argv[5]) : 0;
+    int histogramBits = argc > 6 ? atoi(argv[6]) : 0;
+    int restarts = argc > 7 ? atoi(argv[7]) : 1;
+    double cancelSlack = argc > 8 ? atof(argv[8]) : -1;
+
+    printf("\n\n========== K-means Clustering ==========\n\n");
+    char filename[256];
+
+    strcpy(filename, argv[1]);
+    printf("Image set to %s\n", filename);
+    cv::Mat image = cv::imread(filename);
+    cv::Mat original = image.clone();
+    if (image.empty())
+    {
+        printf("No image data\n");
+        return -1;
+    }
+
+    // kmeans clustering
+    int K = atoi(argv[2]);
+    printf("Number of colors set to %d\n", K);
+
+    if (batchSize > 0 || histogramBits > 0)
+    {
+        // cluster without copying every pixel
+        std::vector<cv::Vec3b> means;
+        KmeansStats stats;
+        if (batchSize > 0)
+        {
+            printf("Running mini-batch kmeans with batches of %d ...\n", batchSize);
+            if (kmeansMiniBatch(image, means, K, batchSize, 500, 0, seeding, seed, &stats) != 0)
+            {
+                return -1;
+            }
+            printf("Batches: %d, estimated inertia: %.0f\n", stats.iterations, stats.inertia);
+        }
+        else
+        {
+            printf("Running kmeans on a color cube of %d bits per channel ...\n", histogramBits);
+            if (kmeansHistogram(image, means, K, histogramBits, 10, 0, seed, &stats) != 0)
+            {
+                return -1;
+            }
+            printf("Iterations: %d, inertia of the cells: %.0f\n", stats.iterations, stats.inertia);
+        }
+
+        printf("Updating image with kmeans ...\n");
+        remapNearestColors(original, image, means);
+
+        cv::imshow("Original", original);
+        cv::imshow("K-means", image);
+        cv::waitKey(0);
+        cv::imwrite(filename + std::to_string(K) + "_kmeans.jpg", image);
+        return 0;
+    }
+    std::vector<cv::Vec3b> data;
+    std::vector<cv::Vec3b> means;
+
+    printf("Creating labels ...\n");
+    cv::Mat labels(image.rows, image.cols, kmeansLabelDepth(K));
+
+    printf("Extracting pixels from image ...\n");
+    for (int i = 0; i < image.rows; i++)
+    {
+        for (int j = 0; j < image.cols; j++)
+        {
+            data.push_back(image.at<cv::Vec3b>(i, j));
+        }
+    }
+
+    try
+    {
+        int data_size = data.size();
+        printf("Data size: %d\n", data_size);
+        printf("Valid K: %d\n", (data_size % K));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+    }
+
+    int maxIterations = 10;
+    int stopThresh = 0;
+    printf("\n=============================\n\n");
+    printf("Running kmeans ...\n");
+    KmeansStats stats;
+    if (restarts > 1)
+    {
+        printf("Keeping the best of %d restarts ...\n", restarts);
+        if (kmeansRestarts(data, means, labels, K, restarts, maxIterations, stopThresh, seeding, seed,
+                           cancelSlack, &stats) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        if (kmeans(data, means, labels, K, maxIterations, stopThresh, seeding, seed, KMEANS_ASSIGN_AUTO, &stats) != 0)
+        {
+            return -1;
+        }
+    }
+    printf("Iterations: %d, inertia: %.0f\n", stats.iterations, stats.inertia);
+
+    printf("Updating image with kmeans ...\n");
+    if (writeLabelColors(labels.reshape(1, image.rows), means, image) != 0)
+    {
+        return -1;
+    }
+
+    printf("Presenting images ...\n");
+
+    cv::imshow("Original", original);
+    cv::imshow("K-means", image);
+    cv::waitKey(0);
+    cv::imwrite(filename + std::to_string(K) + "_kmeans.jpg", image);
+
+    return 0;
+}
\ No newline at end of file
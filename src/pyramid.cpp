@@ -0,0 +1,164 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Gaussian image pyramid built with a fused 5x5 blur and 2x decimation.
+
+#include <algorithm>
+#include <cstdio>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "pyramid.h"
+
+// Number of channel values replicated on each side of the line buffer (2 pixels for the 5 tap kernel)
+static const int PAD = 2 * 3;
+
+/**
+ * @brief Compute one output row of a pyramid level from the level above it.
+ *
+ * The vertical [1 2 4 2 1] pass runs over the full width into the line buffer with unit stride. The horizontal pass
+ * also runs over the full width with unit stride, so both loops vectorize, and the kept pixels are then picked out of
+ * its result. Evaluating the odd pixels too is cheaper than a stride 6 scalar loop over the even ones.
+ *
+ * @param prev The larger level.
+ * @param y The output row to compute.
+ * @param line The line buffer, (prev.cols * 3 + 2 * PAD) values.
+ * @param blurred The horizontal pass buffer, (prev.cols * 3) values.
+ * @param ptrDst The output row.
+ */
+static void decimateRow(const cv::Mat &prev, int y, std::vector<ushort> &line, std::vector<uchar> &blurred,
+                        uchar *ptrDst)
+{
+    const int width = prev.cols * 3;
+    const int dstCols = (prev.cols + 1) / 2;
+    const int last = prev.rows - 1;
+
+    const uchar *ptrTwoUp = prev.ptr<uchar>(std::max(2 * y - 2, 0));
+    const uchar *ptrOneUp = prev.ptr<uchar>(std::max(2 * y - 1, 0));
+    const uchar *ptr = prev.ptr<uchar>(std::min(2 * y, last));
+    const uchar *ptrOneDown = prev.ptr<uchar>(std::min(2 * y + 1, last));
+    const uchar *ptrTwoDown = prev.ptr<uchar>(std::min(2 * y + 2, last));
+
+    // Vertical pass
+    ushort *v = line.data() + PAD;
+    for (int i = 0; i < width; i++)
+    {
+        v[i] = ptrTwoUp[i] + 2 * ptrOneUp[i] + 4 * ptr[i] + 2 * ptrOneDown[i] + ptrTwoDown[i];
+    }
+
+    // Replicate the first and last pixel into the padding
+    for (int i = 0; i < PAD; i++)
+    {
+        v[i - PAD] = v[i % 3];
+        v[width + i] = v[width - 3 + i % 3];
+    }
+
+    // Horizontal pass, rounded and divided by the kernel sum of 100. The sum is at most 25500 so it fits a ushort.
+    uchar *h = blurred.data();
+    for (int i = 0; i < width; i++)
+    {
+        ushort sum = v[i - 6] + 2 * v[i - 3] + 4 * v[i] + 2 * v[i + 3] + v[i + 6];
+        h[i] = (uchar)((sum + 50) / 100);
+    }
+
+    // Keep every second pixel
+    for (int x = 0; x < dstCols; x++)
+    {
+        ptrDst[3 * x] = h[6 * x];
+        ptrDst[3 * x + 1] = h[6 * x + 1];
+        ptrDst[3 * x + 2] = h[6 * x + 2];
+    }
+}
+
+/**
+ * @brief Blur a color image with the 5x5 Gaussian from blur5x5_5 and halve its size in one step.
+ *
+ * Only the pixels that survive the decimation are computed. Edges are handled by replicating the border pixels and the
+ * result is rounded to the nearest value.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The destination image, ((src.rows + 1) / 2) x ((src.cols + 1) / 2).
+ * @return 0 if successful, -1 if error.
+ */
+int pyrDown5x5(const cv::Mat &src, cv::Mat &dst)
+{
+    std::vector<cv::Mat> pyramid;
+    if (buildPyramid5x5(src, pyramid, 1) != 0 || pyramid.size() < 2)
+    {
+        return -1;
+    }
+
+    dst = pyramid[1];
+    return 0;
+}
+
+/**
+ * @brief Build a Gaussian pyramid with the fused 5x5 blur and 2x decimation.
+ *
+ * All levels are produced in a single pass over the source rows. As soon as a level has the rows needed for the next
+ * output row of the level below it, that row is computed, so every level works on rows that were just written and are
+ * still in cache. Each level keeps a single line buffer for its vertical pass.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param pyramid The pyramid. pyramid[0] shares its data with src and pyramid[i] is half the size of pyramid[i - 1].
+ * @param maxLevel The index of the smallest level. Fewer levels are produced if the image reaches 1x1 first.
+ * @return 0 if successful, -1 if error.
+ */
+int buildPyramid5x5(const cv::Mat &src, std::vector<cv::Mat> &pyramid, int maxLevel)
+{
+    if (src.empty() || src.type() != CV_8UC3)
+    {
+        printf("Frame is empty or not CV_8UC3\n");
+        return -1;
+    }
+
+    pyramid.resize(1);
+    pyramid[0] = src;
+    for (int level = 1; level <= maxLevel; level++)
+    {
+        const cv::Mat &prev = pyramid[level - 1];
+        if (prev.rows == 1 && prev.cols == 1)
+        {
+            break;
+        }
+        pyramid.push_back(cv::Mat((prev.rows + 1) / 2, (prev.cols + 1) / 2, CV_8UC3));
+    }
+
+    const int levels = pyramid.size();
+    std::vector<std::vector<ushort>> lines(levels);
+    std::vector<std::vector<uchar>> blurred(levels);
+    std::vector<int> nextRow(levels, 0);
+    for (int level = 1; level < levels; level++)
+    {
+        lines[level].resize(pyramid[level - 1].cols * 3 + 2 * PAD);
+        blurred[level].resize(pyramid[level - 1].cols * 3);
+    }
+
+    // Stream the source rows. Row y of level - 1 being ready may complete rows of every level below it.
+    for (int y = 0; y < src.rows; y++)
+    {
+        int ready = y;
+        for (int level = 1; level < levels; level++)
+        {
+            const cv::Mat &prev = pyramid[level - 1];
+            cv::Mat &cur = pyramid[level];
+            int produced = -1;
+
+            // Output row r needs rows up to 2r + 2 of the level above, clamped to its last row
+            while (nextRow[level] < cur.rows && std::min(2 * nextRow[level] + 2, prev.rows - 1) <= ready)
+            {
+                decimateRow(prev, nextRow[level], lines[level], blurred[level], cur.ptr<uchar>(nextRow[level]));
+                produced = nextRow[level];
+                nextRow[level]++;
+            }
+
+            if (produced < 0)
+            {
+                break;
+            }
+            ready = produced;
+        }
+    }
+
+    return 0;
+}
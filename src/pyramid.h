@@ -0,0 +1,38 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Gaussian image pyramid built with a fused 5x5 blur and 2x decimation.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+/**
+ * @brief Blur a color image with the 5x5 Gaussian from blur5x5_5 and halve its size in one step.
+ *
+ * Only the pixels that survive the decimation are computed. Edges are handled by replicating the border pixels and the
+ * result is rounded to the nearest value.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The destination image, ((src.rows + 1) / 2) x ((src.cols + 1) / 2).
+ * @return 0 if successful, -1 if error.
+ */
+int pyrDown5x5(const cv::Mat &src, cv::Mat &dst);
+
+/**
+ * @brief Build a Gaussian pyramid with the fused 5x5 blur and 2x decimation.
+ *
+ * All levels are produced in a single pass over the source rows. As soon as a level has the rows needed for the next
+ * output row of the level below it, that row is computed, so every level works on rows that were just written and are
+ * still in cache. Each level keeps a single line buffer for its vertical pass.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param pyramid The pyramid. pyramid[0] shares its data with src and pyramid[i] is half the size of pyramid[i - 1].
+ * @param maxLevel The index of the smallest level. Fewer levels are produced if the image reaches 1x1 first.
+ * @return 0 if successful, -1 if error.
+ */
+int buildPyramid5x5(const cv::Mat &src, std::vector<cv::Mat> &pyramid, int maxLevel);
+
+#endif
@@ -0,0 +1,456 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Palette generation by median cut and octree over a color histogram, and the error of a quantized image.
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "quantize.h"
+
+/**
+ * @brief Count the colors of an image in a color cube.
+ *
+ * Every occupied cell gives one color, the mean color of its pixels, and the number of its pixels. The cube is counted
+ * in parallel, one histogram per thread, but only as many threads as fit their histograms in
+ * QUANTIZE_HISTOGRAM_MAX_BYTES. The memory used is at most that budget plus 32 bytes per cell for the totals, whatever
+ * the number of threads or the size of the image.
+ *
+ * @param image The CV_8UC3 image.
+ * @param colors Receives the mean color of every occupied cell, in cell order.
+ * @param counts Receives the number of pixels of every occupied cell.
+ * @param bits The number of bits kept per channel, the cube has 2^(3 * bits) cells.
+ * @return 0 if successful, -1 if error.
+ */
+int colorHistogram(const cv::Mat &image, std::vector<cv::Vec3b> &colors, std::vector<int> &counts, int bits)
+{
+    if (image.empty() || image.type() != CV_8UC3)
+    {
+        printf("error: colorHistogram needs a CV_8UC3 image\n");
+        return -1;
+    }
+    if (bits < 1 || bits > QUANTIZE_HISTOGRAM_MAX_BITS)
+    {
+        printf("error: bits must be in [1, %d]\n", QUANTIZE_HISTOGRAM_MAX_BITS);
+        return -1;
+    }
+
+    // count the pixels and sum their colors per cell, one histogram per worker and a stripe of rows per worker. Only as
+    // many workers as fit their histograms in the memory budget.
+    const int drop = 8 - bits;
+    const int cells = 1 << (3 * bits);
+    int workers = std::min(cv::getNumThreads(), (int)(QUANTIZE_HISTOGRAM_MAX_BYTES / (cells * sizeof(cv::Vec4i))));
+    workers = std::max(1, std::min(workers, image.rows));
+    int rowsPerWorker = (image.rows + workers - 1) / workers;
+
+    // A worker adds its histogram to the totals after every chunk of rows, so its int sums never overflow
+    int chunkRows = std::max(1, (INT_MAX / 255) / image.cols);
+    std::vector<cv::Vec<int64, 4> > totals(cells, cv::Vec<int64, 4>(0, 0, 0, 0));
+    std::mutex lock;
+    cv::parallel_for_(
+        cv::Range(0, workers),
+        [&](const cv::Range &range) {
+            std::vector<cv::Vec4i> hist;
+            for (int w = range.start; w < range.end; w++)
+            {
+                int end = std::min(image.rows, (w + 1) * rowsPerWorker);
+                for (int first = w * rowsPerWorker; first < end; first += chunkRows)
+                {
+                    hist.assign(cells, cv::Vec4i(0, 0, 0, 0));
+                    int last = std::min(end, first + chunkRows);
+                    for (int i = first; i < last; i++)
+                    {
+                        const cv::Vec3b *ptr = image.ptr<cv::Vec3b>(i);
+                        for (int j = 0; j < image.cols; j++)
+                        {
+                            int cell = ((ptr[j][0] >> drop) << (2 * bits)) | ((ptr[j][1] >> drop) << bits) |
+                                       (ptr[j][2] >> drop);
+                            cv::Vec4i &h = hist[cell];
+                            h[0] += ptr[j][0];
+                            h[1] += ptr[j][1];
+                            h[2] += ptr[j][2];
+                            h[3]++;
+                        }
+                    }
+
+                    std::lock_guard<std::mutex> guard(lock);
+                    for (int cell = 0; cell < cells; cell++)
+                    {
+                        if (hist[cell][3] > 0)
+                        {
+                            for (int c = 0; c < 4; c++)
+                            {
+                                totals[cell][c] += hist[cell][c];
+                            }
+                        }
+                    }
+                }
+            }
+        },
+        workers);
+
+    // every occupied cell gives its mean color and count
+    colors.clear();
+    counts.clear();
+    for (int cell = 0; cell < cells; cell++)
+    {
+        const cv::Vec<int64, 4> &sum = totals[cell];
+        if (sum[3] > 0)
+        {
+            colors.push_back(cv::Vec3b((uchar)((sum[0] + sum[3] / 2) / sum[3]), (uchar)((sum[1] + sum[3] / 2) / sum[3]),
+                                       (uchar)((sum[2] + sum[3] / 2) / sum[3])));
+            counts.push_back((int)sum[3]);
+        }
+    }
+
+    return 0;
+}
+
+// A box of median cut, the colors at order[begin] to order[end - 1]
+struct ColorBox
+{
+    int begin;
+    int end;
+    int axis;     // the channel with the largest squared error, the one a split cuts
+    double error; // the squared error of the box, 0 if it cannot be split
+    cv::Vec3b mean;
+};
+
+/**
+ * @brief Compute the mean color, squared error and split axis of a box of median cut.
+ */
+static void measureBox(const std::vector<cv::Vec3b> &colors, const std::vector<int> &counts,
+                       const std::vector<int> &order, ColorBox &box)
+{
+    double weight = 0, sum[3] = {0, 0, 0}, squares[3] = {0, 0, 0};
+    for (int i = box.begin; i < box.end; i++)
+    {
+        const cv::Vec3b &c = colors[order[i]];
+        double w = counts[order[i]];
+        weight += w;
+        for (int k = 0; k < 3; k++)
+        {
+            sum[k] += w * c[k];
+            squares[k] += w * c[k] * c[k];
+        }
+    }
+
+    box.axis = 0;
+    box.error = 0;
+    double largest = -1;
+    for (int k = 0; k < 3; k++)
+    {
+        double error = std::max(0.0, squares[k] - sum[k] * sum[k] / weight);
+        box.error += error;
+        if (error > largest)
+        {
+            largest = error;
+            box.axis = k;
+        }
+        box.mean[k] = cv::saturate_cast<uchar>(sum[k] / weight);
+    }
+    if (box.end - box.begin < 2)
+    {
+        box.error = 0;
+    }
+}
+
+/**
+ * @brief Build a palette of an image by median cut.
+ *
+ * Starting from one box holding every color of the histogram, the box with the largest squared error is split at the
+ * weighted median of its channel with the largest squared error until there are K boxes. Every box gives the mean
+ * color of its pixels.
+ *
+ * @param image The CV_8UC3 image.
+ * @param palette Receives at most K colors, fewer only if the image has fewer distinct cells.
+ * @param K The number of colors.
+ * @param bits The number of bits per channel of the color histogram.
+ * @return 0 if successful, -1 if error.
+ */
+int medianCutPalette(const cv::Mat &image, std::vector<cv::Vec3b> &palette, int K, int bits)
+{
+    if (K < 1)
+    {
+        printf("error: K must be at least 1\n");
+        return -1;
+    }
+    std::vector<cv::Vec3b> colors;
+    std::vector<int> counts;
+    if (colorHistogram(image, colors, counts, bits) != 0)
+    {
+        return -1;
+    }
+
+    // the boxes partition order into contiguous ranges
+    std::vector<int> order(colors.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = (int)i;
+    }
+    std::vector<ColorBox> boxes(1);
+    boxes[0].begin = 0;
+    boxes[0].end = (int)order.size();
+    measureBox(colors, counts, order, boxes[0]);
+
+    while ((int)boxes.size() < K)
+    {
+        // split the box with the largest error
+        int worst = 0;
+        for (int b = 1; b < (int)boxes.size(); b++)
+        {
+            if (boxes[b].error > boxes[worst].error)
+            {
+                worst = b;
+            }
+        }
+        if (boxes[worst].error <= 0)
+        {
+            break;
+        }
+
+        ColorBox box = boxes[worst];
+        int axis = box.axis;
+        std::sort(order.begin() + box.begin, order.begin() + box.end, [&](int a, int b) {
+            return colors[a][axis] < colors[b][axis] || (colors[a][axis] == colors[b][axis] && a < b);
+        });
+
+        // cut at the weighted median, keeping at least one color on each side
+        int64 total = 0;
+        for (int i = box.begin; i < box.end; i++)
+        {
+            total += counts[order[i]];
+        }
+        int64 cumulative = 0;
+        int cut = box.begin + 1;
+        for (int i = box.begin; i < box.end - 1; i++)
+        {
+            cumulative += counts[order[i]];
+            cut = i + 1;
+            if (2 * cumulative >= total)
+            {
+                break;
+            }
+        }
+
+        ColorBox upper = box;
+        boxes[worst].end = cut;
+        upper.begin = cut;
+        measureBox(colors, counts, order, boxes[worst]);
+        measureBox(colors, counts, order, upper);
+        boxes.push_back(upper);
+    }
+
+    palette.resize(boxes.size());
+    for (size_t b = 0; b < boxes.size(); b++)
+    {
+        palette[b] = boxes[b].mean;
+    }
+
+    return 0;
+}
+
+// A node of the octree, a leaf when it has no children
+struct OctreeNode
+{
+    int children[8]; // indices of the child nodes, -1 if absent
+    int64 sum[3];    // the summed colors of every pixel below the node
+    int64 count;     // the number of pixels below the node
+};
+
+/**
+ * @brief Build a palette of an image with an octree.
+ *
+ * The colors of the histogram are inserted into an octree with one level per bit, then the nodes of the deepest level
+ * with children are merged into their parent, the least populated first, until at most K leaves remain. Every leaf
+ * gives the mean color of its pixels. The last merge folds only as many children as needed, so the palette has
+ * exactly K colors unless the image has fewer distinct cells.
+ *
+ * @param image The CV_8UC3 image.
+ * @param palette Receives at most K colors, fewer only if the image has fewer distinct cells.
+ * @param K The number of colors.
+ * @param bits The number of bits per channel of the color histogram, also the depth of the octree.
+ * @return 0 if successful, -1 if error.
+ */
+int octreePalette(const cv::Mat &image, std::vector<cv::Vec3b> &palette, int K, int bits)
+{
+    if (K < 1)
+    {
+        printf("error: K must be at least 1\n");
+        return -1;
+    }
+    std::vector<cv::Vec3b> colors;
+    std::vector<int> counts;
+    if (colorHistogram(image, colors, counts, bits) != 0)
+    {
+        return -1;
+    }
+
+    // insert every cell, all nodes live in one pool and every node on the path accumulates the cell
+    std::vector<OctreeNode> nodes(1);
+    std::fill(nodes[0].children, nodes[0].children + 8, -1);
+    nodes[0].sum[0] = nodes[0].sum[1] = nodes[0].sum[2] = nodes[0].count = 0;
+    std::vector<std::vector<int> > levels(bits); // the nodes of each level that have children
+    int leaves = 0;
+    for (size_t i = 0; i < colors.size(); i++)
+    {
+        const cv::Vec3b &c = colors[i];
+        int node = 0;
+        for (int level = 0; level <= bits; level++)
+        {
+            OctreeNode &n = nodes[node];
+            n.count += counts[i];
+            for (int k = 0; k < 3; k++)
+            {
+                n.sum[k] += (int64)c[k] * counts[i];
+            }
+            if (level == bits)
+            {
+                break;
+            }
+
+            int shift = 7 - level;
+            int child = (((c[0] >> shift) & 1) << 2) | (((c[1] >> shift) & 1) << 1) | ((c[2] >> shift) & 1);
+            if (n.children[child] < 0)
+            {
+                if (std::count(n.children, n.children + 8, -1) == 8)
+                {
+                    levels[level].push_back(node);
+                }
+                OctreeNode leaf;
+                std::fill(leaf.children, leaf.children + 8, -1);
+                leaf.sum[0] = leaf.sum[1] = leaf.sum[2] = leaf.count = 0;
+                nodes[node].children[child] = (int)nodes.size();
+                nodes.push_back(leaf);
+                if (level == bits - 1)
+                {
+                    leaves++;
+                }
+            }
+            node = nodes[node].children[child];
+        }
+    }
+
+    // merge the deepest nodes first, and within a level the least populated first. Every deeper node has been merged
+    // by the time a level is reached, so the children of its nodes are leaves. When merging all of them would leave
+    // fewer than K leaves, only the least populated children are folded into one, which leaves exactly K.
+    for (int level = bits - 1; level >= 0 && leaves > K; level--)
+    {
+        std::vector<int> &candidates = levels[level];
+        std::sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+            return nodes[a].count < nodes[b].count || (nodes[a].count == nodes[b].count && a < b);
+        });
+        for (size_t i = 0; i < candidates.size() && leaves > K; i++)
+        {
+            int *children = nodes[candidates[i]].children;
+            std::vector<int> merged;
+            for (int child = 0; child < 8; child++)
+            {
+                if (children[child] >= 0)
+                {
+                    merged.push_back(child);
+                }
+            }
+            int removed = (int)merged.size() - 1;
+            if (leaves - removed >= K)
+            {
+                std::fill(children, children + 8, -1);
+                leaves -= removed;
+                continue;
+            }
+
+            std::sort(merged.begin(), merged.end(), [&](int a, int b) {
+                return nodes[children[a]].count < nodes[children[b]].count ||
+                       (nodes[children[a]].count == nodes[children[b]].count && a < b);
+            });
+            OctreeNode &into = nodes[children[merged[0]]];
+            for (int m = 1; m <= leaves - K; m++)
+            {
+                const OctreeNode &from = nodes[children[merged[m]]];
+                for (int k = 0; k < 3; k++)
+                {
+                    into.sum[k] += from.sum[k];
+                }
+                into.count += from.count;
+                children[merged[m]] = -1;
+            }
+            leaves = K;
+        }
+    }
+
+    // every leaf gives one color
+    palette.clear();
+    std::vector<int> stack(1, 0);
+    while (!stack.empty())
+    {
+        const OctreeNode &n = nodes[stack.back()];
+        stack.pop_back();
+        bool leaf = true;
+        for (int child = 7; child >= 0; child--)
+        {
+            if (n.children[child] >= 0)
+            {
+                stack.push_back(n.children[child]);
+                leaf = false;
+            }
+        }
+        if (leaf && n.count > 0)
+        {
+            palette.push_back(cv::Vec3b((uchar)((n.sum[0] + n.count / 2) / n.count),
+                                        (uchar)((n.sum[1] + n.count / 2) / n.count),
+                                        (uchar)((n.sum[2] + n.count / 2) / n.count)));
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Measure how far a quantized image is from its original.
+ *
+ * @param src The original CV_8UC3 image.
+ * @param dst The quantized CV_8UC3 image of the same size.
+ * @param mse Receives the mean squared error per channel.
+ * @param psnr Receives the peak signal to noise ratio in dB, infinite for identical images.
+ * @return 0 if successful, -1 if error.
+ */
+int quantizationError(const cv::Mat &src, const cv::Mat &dst, double &mse, double &psnr)
+{
+    if (src.empty() || src.type() != CV_8UC3 || dst.type() != CV_8UC3 || src.rows != dst.rows ||
+        src.cols != dst.cols)
+    {
+        printf("error: quantizationError needs two CV_8UC3 images of the same size\n");
+        return -1;
+    }
+
+    std::vector<int64> partial(src.rows);
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++)
+        {
+            const uchar *a = src.ptr<uchar>(i);
+            const uchar *b = dst.ptr<uchar>(i);
+            int64 sum = 0;
+            for (int j = 0; j < 3 * src.cols; j++)
+            {
+                int d = a[j] - b[j];
+                sum += d * d;
+            }
+            partial[i] = sum;
+        }
+    });
+    int64 total = 0;
+    for (int i = 0; i < src.rows; i++)
+    {
+        total += partial[i];
+    }
+
+    mse = (double)total / (3.0 * src.total());
+    psnr = mse > 0 ? 10 * std::log10(255.0 * 255.0 / mse) : HUGE_VAL;
+
+    return 0;
+}
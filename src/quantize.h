@@ -0,0 +1,79 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Palette generation by median cut and octree over a color histogram, and the error of a quantized image.
+
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+// Bits kept per channel by the color histogram of the quantizers and kmeansHistogram, 5 gives 32^3 cells
+#define QUANTIZE_HISTOGRAM_BITS 5
+#define QUANTIZE_HISTOGRAM_MAX_BITS 6
+
+// Upper limit on the memory of the per thread histograms of colorHistogram, 16 bytes per cell each. At 6 bits a
+// histogram takes 4 MB, so at most 4 threads count in parallel.
+#define QUANTIZE_HISTOGRAM_MAX_BYTES (16 << 20)
+
+/**
+ * @brief Count the colors of an image in a color cube.
+ *
+ * Every occupied cell gives one color, the mean color of its pixels, and the number of its pixels. The cube is counted
+ * in parallel, one histogram per thread, but only as many threads as fit their histograms in
+ * QUANTIZE_HISTOGRAM_MAX_BYTES. The memory used is at most that budget plus 32 bytes per cell for the totals, whatever
+ * the number of threads or the size of the image.
+ *
+ * @param image The CV_8UC3 image.
+ * @param colors Receives the mean color of every occupied cell, in cell order.
+ * @param counts Receives the number of pixels of every occupied cell.
+ * @param bits The number of bits kept per channel, the cube has 2^(3 * bits) cells.
+ * @return 0 if successful, -1 if error.
+ */
+int colorHistogram(const cv::Mat &image, std::vector<cv::Vec3b> &colors, std::vector<int> &counts,
+                   int bits = QUANTIZE_HISTOGRAM_BITS);
+
+/**
+ * @brief Build a palette of an image by median cut.
+ *
+ * Starting from one box holding every color of the histogram, the box with the largest squared error is split at the
+ * weighted median of its channel with the largest squared error until there are K boxes. Every box gives the mean
+ * color of its pixels.
+ *
+ * @param image The CV_8UC3 image.
+ * @param palette Receives at most K colors, fewer only if the image has fewer distinct cells.
+ * @param K The number of colors.
+ * @param bits The number of bits per channel of the color histogram.
+ * @return 0 if successful, -1 if error.
+ */
+int medianCutPalette(const cv::Mat &image, std::vector<cv::Vec3b> &palette, int K, int bits = QUANTIZE_HISTOGRAM_BITS);
+
+/**
+ * @brief Build a palette of an image with an octree.
+ *
+ * The colors of the histogram are inserted into an octree with one level per bit, then the nodes of the deepest level
+ * with children are merged into their parent, the least populated first, until at most K leaves remain. Every leaf
+ * gives the mean color of its pixels. The last merge folds only as many children as needed, so the palette has
+ * exactly K colors unless the image has fewer distinct cells.
+ *
+ * @param image The CV_8UC3 image.
+ * @param palette Receives at most K colors, fewer only if the image has fewer distinct cells.
+ * @param K The number of colors.
+ * @param bits The number of bits per channel of the color histogram, also the depth of the octree.
+ * @return 0 if successful, -1 if error.
+ */
+int octreePalette(const cv::Mat &image, std::vector<cv::Vec3b> &palette, int K, int bits = QUANTIZE_HISTOGRAM_BITS);
+
+/**
+ * @brief Measure how far a quantized image is from its original.
+ *
+ * @param src The original CV_8UC3 image.
+ * @param dst The quantized CV_8UC3 image of the same size.
+ * @param mse Receives the mean squared error per channel.
+ * @param psnr Receives the peak signal to noise ratio in dB, infinite for identical images.
+ * @return 0 if successful, -1 if error.
+ */
+int quantizationError(const cv::Mat &src, const cv::Mat &dst, double &mse, double &psnr);
+
+#endif
@@ -0,0 +1,328 @@
+// Author: Kevin Heleodoro
+// Date: October 17, 2026
+// Purpose: Compile time separable convolution kernels. The taps are template arguments so every pass is fully unrolled
+// and the row loops are plain unit stride loops the compiler can vectorize.
+
+#include <cstdio>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+#include <type_traits>
+#include <vector>
+
+#include "cache_info.h"
+
+#ifndef SEPARABLE_KERNEL_H
+#define SEPARABLE_KERNEL_H
+
+/**
+ * @brief Integer log2 of n, rounded down.
+ */
+constexpr int kernelLog2(int n)
+{
+    return n <= 1 ? 0 : 1 + kernelLog2(n / 2);
+}
+
+/**
+ * @brief Unrolled dot product of a list of taps with a column or a row of pixels.
+ *
+ * Idx is the index of the first tap in the list. Zero taps are dropped at compile time.
+ */
+template <int Idx, int... Taps> struct TapDot;
+
+template <int Idx> struct TapDot<Idx>
+{
+    static const int sum = 0;
+    static const int absSum = 0;
+
+    template <typename Acc, typename T> static inline Acc column(const T *const *rows, int i)
+    {
+        return 0;
+    }
+
+    template <typename Acc, int Step, typename T> static inline Acc row(const T *ptr)
+    {
+        return 0;
+    }
+};
+
+template <int Idx, int Tap, int... Rest> struct TapDot<Idx, Tap, Rest...>
+{
+    static const int sum = Tap + TapDot<Idx + 1, Rest...>::sum;
+    static const int absSum = (Tap < 0 ? -Tap : Tap) + TapDot<Idx + 1, Rest...>::absSum;
+
+    // sum of Tap[j] * rows[j][i]
+    template <typename Acc, typename T> static inline Acc column(const T *const *rows, int i)
+    {
+        return (Tap == 0 ? Acc(0) : Acc(Tap * rows[Idx][i])) + TapDot<Idx + 1, Rest...>::template column<Acc>(rows, i);
+    }
+
+    // sum of Tap[j] * ptr[j * Step]
+    template <typename Acc, int Step, typename T> static inline Acc row(const T *ptr)
+    {
+        return (Tap == 0 ? Acc(0) : Acc(Tap * ptr[Idx * Step])) +
+               TapDot<Idx + 1, Rest...>::template row<Acc, Step>(ptr);
+    }
+};
+
+/**
+ * @brief A 1D kernel with an odd number of integer taps, e.g. SeparableKernel<1, 2, 1>.
+ */
+template <int... Taps> struct SeparableKernel
+{
+    static const int size = sizeof...(Taps);
+    static const int radius = size / 2;
+    static const int sum = TapDot<0, Taps...>::sum;
+    static const int absSum = TapDot<0, Taps...>::absSum;
+
+    static_assert(size % 2 == 1, "SeparableKernel needs an odd number of taps");
+
+    template <typename Acc, typename T> static inline Acc column(const T *const *rows, int i)
+    {
+        return TapDot<0, Taps...>::template column<Acc>(rows, i);
+    }
+
+    template <typename Acc, int Step, typename T> static inline Acc row(const T *ptr)
+    {
+        return TapDot<0, Taps...>::template row<Acc, Step>(ptr);
+    }
+};
+
+/**
+ * @brief A 2D kernel given as the outer product of a horizontal and a vertical SeparableKernel.
+ *
+ * Everything about how the kernel is applied is derived from the taps at compile time:
+ * - Kernels whose taps sum to 0 (derivatives) produce unnormalized CV_16SC3 output.
+ * - Other kernels produce CV_8UC3 output divided by the sum of the 2D kernel, using a shift when the sum is a power of
+ *   two.
+ * - The accumulator is a short when the worst case sum fits in 16 bits, which doubles the SIMD width, and an int
+ *   otherwise.
+ */
+template <class H, class V> struct Kernel2D
+{
+    typedef H Horizontal;
+    typedef V Vertical;
+
+    static const int sum = H::sum * V::sum;
+    static const bool isDerivative = sum == 0;
+    static const bool isPowerOfTwo = sum > 0 && (sum & (sum - 1)) == 0;
+    static const int shift = kernelLog2(sum);
+
+    typedef typename std::conditional<H::absSum * V::absSum * 255 <= 32767, short, int>::type Acc;
+    typedef typename std::conditional<isDerivative, short, uchar>::type Output;
+
+    static const int outputType = isDerivative ? CV_16SC3 : CV_8UC3;
+
+    static inline Output normalize(int acc)
+    {
+        if (isDerivative)
+        {
+            return cv::saturate_cast<Output>(acc);
+        }
+        if (isPowerOfTwo)
+        {
+            return cv::saturate_cast<Output>(acc >> shift);
+        }
+        return cv::saturate_cast<Output>(acc / (isDerivative ? 1 : sum));
+    }
+};
+
+/**
+ * @brief Apply a Kernel2D to a color image.
+ *
+ * Each output row is computed with a vertical pass over the source rows into a single row buffer followed by a
+ * horizontal pass over that buffer. The row is processed as a flat array of channel values so neither pass has a per
+ * channel inner loop. Pixels closer to the edge than the kernel radius are copied from src for smoothing kernels and
+ * set to 0 for derivative kernels.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The destination image, CV_8UC3 or CV_16SC3 depending on the kernel.
+ * @return 0 if successful, -1 if error.
+ */
+template <class Kernel> int separableFilter(const cv::Mat &src, cv::Mat &dst)
+{
+    typedef typename Kernel::Horizontal H;
+    typedef typename Kernel::Vertical V;
+    typedef typename Kernel::Acc Acc;
+    typedef typename Kernel::Output Output;
+    const int cn = 3;
+
+    if (src.empty() || src.type() != CV_8UC3)
+    {
+        printf("Frame is empty or not CV_8UC3\n");
+        return -1;
+    }
+
+    if (dst.data == src.data)
+    {
+        // Rows above the current one are still needed after they are written, so filter from a copy
+        cv::Mat copy = src.clone();
+        return separableFilter<Kernel>(copy, dst);
+    }
+
+    dst.create(src.size(), Kernel::outputType);
+
+    const int width = src.cols * cn;
+    const int left = H::radius * cn;
+    const int right = width - H::radius * cn;
+    std::vector<Acc> column(width);
+    const uchar *rows[V::size];
+
+    for (int y = 0; y < src.rows; y++)
+    {
+        Output *ptrDst = dst.ptr<Output>(y);
+
+        // Border rows
+        if (y < V::radius || y >= src.rows - V::radius || right <= left)
+        {
+            for (int i = 0; i < width; i++)
+            {
+                ptrDst[i] = Kernel::isDerivative ? 0 : src.ptr<uchar>(y)[i];
+            }
+            continue;
+        }
+
+        // Vertical pass into the row buffer
+        for (int j = 0; j < V::size; j++)
+        {
+            rows[j] = src.ptr<uchar>(y - V::radius + j);
+        }
+        for (int i = 0; i < width; i++)
+        {
+            column[i] = V::template column<Acc>(rows, i);
+        }
+
+        // Horizontal pass over the row buffer
+        const Acc *ptrColumn = column.data() - left;
+        for (int i = left; i < right; i++)
+        {
+            ptrDst[i] = Kernel::normalize(H::template row<Acc, 3>(ptrColumn + i));
+        }
+
+        // Border columns
+        for (int i = 0; i < left; i++)
+        {
+            ptrDst[i] = Kernel::isDerivative ? 0 : rows[V::radius][i];
+            ptrDst[width - 1 - i] = Kernel::isDerivative ? 0 : rows[V::radius][width - 1 - i];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Apply a Kernel2D to a color image one cache sized column strip at a time.
+ *
+ * Gives the same result as separableFilter. The vertical pass of separableFilter reads V::size full source rows for
+ * every output row, which on very wide images no longer fit in cache. Here the image is split into column strips sized
+ * from the detected cache sizes, so the V::size row segments of a strip and the row buffer stay cache resident and each
+ * source row segment is fetched from memory once per strip.
+ *
+ * @param src The CV_8UC3 source image.
+ * @param dst The destination image, CV_8UC3 or CV_16SC3 depending on the kernel.
+ * @param stripWidth The strip width in pixels. 0 picks it from the detected cache sizes.
+ * @return 0 if successful, -1 if error.
+ */
+template <class Kernel> int separableFilterTiled(const cv::Mat &src, cv::Mat &dst, int stripWidth = 0)
+{
+    typedef typename Kernel::Horizontal H;
+    typedef typename Kernel::Vertical V;
+    typedef typename Kernel::Acc Acc;
+    typedef typename Kernel::Output Output;
+    const int cn = 3;
+
+    if (src.empty() || src.type() != CV_8UC3)
+    {
+        printf("Frame is empty or not CV_8UC3\n");
+        return -1;
+    }
+
+    if (dst.data == src.data)
+    {
+        cv::Mat copy = src.clone();
+        return separableFilterTiled<Kernel>(copy, dst, stripWidth);
+    }
+
+    dst.create(src.size(), Kernel::outputType);
+
+    const int width = src.cols * cn;
+    const int left = H::radius * cn;
+    const int right = width - H::radius * cn;
+
+    // Border rows and columns, same as separableFilter
+    for (int y = 0; y < src.rows; y++)
+    {
+        const uchar *ptr = src.ptr<uchar>(y);
+        Output *ptrDst = dst.ptr<Output>(y);
+        if (y < V::radius || y >= src.rows - V::radius || right <= left)
+        {
+            for (int i = 0; i < width; i++)
+            {
+                ptrDst[i] = Kernel::isDerivative ? 0 : ptr[i];
+            }
+            continue;
+        }
+        for (int i = 0; i < left; i++)
+        {
+            ptrDst[i] = Kernel::isDerivative ? 0 : ptr[i];
+            ptrDst[width - 1 - i] = Kernel::isDerivative ? 0 : ptr[width - 1 - i];
+        }
+    }
+
+    if (right <= left || src.rows < V::size)
+    {
+        return 0;
+    }
+
+    if (stripWidth <= 0)
+    {
+        stripWidth = tileStripWidth(V::size * cn + cn * sizeof(Acc));
+    }
+
+    // The strip plus the kernel halo on each side
+    const int stripValues = stripWidth * cn;
+    std::vector<Acc> column(stripValues + 2 * left);
+    const uchar *rows[V::size];
+
+    for (int x0 = left; x0 < right; x0 += stripValues)
+    {
+        const int n = std::min(stripValues, right - x0);
+
+        for (int y = V::radius; y < src.rows - V::radius; y++)
+        {
+            // Vertical pass over the strip and its halo. Moving to the next row reuses V::size - 1 of these row
+            // segments, which are still in L1.
+            for (int j = 0; j < V::size; j++)
+            {
+                rows[j] = src.ptr<uchar>(y - V::radius + j) + x0 - left;
+            }
+            for (int i = 0; i < n + 2 * left; i++)
+            {
+                column[i] = V::template column<Acc>(rows, i);
+            }
+
+            // Horizontal pass over the strip
+            Output *ptrDst = dst.ptr<Output>(y) + x0;
+            const Acc *ptrColumn = column.data();
+            for (int i = 0; i < n; i++)
+            {
+                ptrDst[i] = Kernel::normalize(H::template row<Acc, 3>(ptrColumn + i));
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Kernels used by filter.cpp. Adding a new one is a single typedef.
+typedef Kernel2D<SeparableKernel<1, 2, 1>, SeparableKernel<1, 2, 1>> Gauss3x3Kernel;
+typedef Kernel2D<SeparableKernel<1, 2, 4, 2, 1>, SeparableKernel<1, 2, 4, 2, 1>> Gauss5x5Kernel;
+typedef Kernel2D<SeparableKernel<1, 6, 15, 20, 15, 6, 1>, SeparableKernel<1, 6, 15, 20, 15, 6, 1>> Gauss7x7Kernel;
+typedef Kernel2D<SeparableKernel<-1, 0, 1>, SeparableKernel<1, 2, 1>> SobelX3x3Kernel;
+typedef Kernel2D<SeparableKernel<1, 2, 1>, SeparableKernel<-1, 0, 1>> SobelY3x3Kernel;
+typedef Kernel2D<SeparableKernel<-1, 0, 1>, SeparableKernel<3, 10, 3>> ScharrX3x3Kernel;
+typedef Kernel2D<SeparableKernel<3, 10, 3>, SeparableKernel<-1, 0, 1>> ScharrY3x3Kernel;
+typedef Kernel2D<SeparableKernel<-1, 0, 1>, SeparableKernel<1, 1, 1>> PrewittX3x3Kernel;
+typedef Kernel2D<SeparableKernel<1, 1, 1>, SeparableKernel<-1, 0, 1>> PrewittY3x3Kernel;
+
+#endif